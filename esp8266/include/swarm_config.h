@@ -0,0 +1,518 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Compile-time configuration =====
+// Every SWARM_* default below can be overridden per environment through
+// platformio.ini build_flags (e.g. -DSWARM_SILENT_MS=150). The typed
+// constexpr copies are what the firmware uses, so unused paths fold away.
+
+// ===== WiFi / UDP =====
+#ifndef SWARM_WIFI_SSID
+#define SWARM_WIFI_SSID "TMOBILE"
+#endif
+#ifndef SWARM_WIFI_PASSWORD
+#define SWARM_WIFI_PASSWORD "Uyen2812"
+#endif
+#ifndef SWARM_UDP_PORT
+#define SWARM_UDP_PORT 4210
+#endif
+
+// Swarm transport. BROADCAST uses 255.255.255.255 as before. MULTICAST joins
+// SWARM_MCAST_GROUP via IGMP and only accepts swarm frames sent to that
+// group, so several swarms can share a subnet by using different groups.
+// All nodes of one swarm must use the same transport.
+#define SWARM_TRANSPORT_BROADCAST 0
+#define SWARM_TRANSPORT_MULTICAST 1
+
+#ifndef SWARM_TRANSPORT
+#define SWARM_TRANSPORT SWARM_TRANSPORT_BROADCAST
+#endif
+#ifndef SWARM_MCAST_GROUP
+#define SWARM_MCAST_GROUP 239, 42, 10, 1
+#endif
+#ifndef SWARM_MCAST_TTL
+#define SWARM_MCAST_TTL 1
+#endif
+
+// Master reports go to the RPi on this port. It defaults to the swarm port as
+// before; giving the RPi its own port means broadcast fallbacks never wake
+// up the slaves either.
+#ifndef SWARM_RPI_PORT
+#define SWARM_RPI_PORT SWARM_UDP_PORT
+#endif
+// A discovered RPi address is used for unicast until nothing (beacon or
+// reset) has been heard from it for this long; then reports fall back to broadcast
+#ifndef SWARM_RPI_TTL_MS
+#define SWARM_RPI_TTL_MS 15000
+#endif
+
+// Fast reconnect: at boot, join the cached BSSID and channel first and,
+// with SWARM_FAST_STATIC_IP, reuse the cached lease instead of waiting for
+// DHCP. Falls back to a full scan plus DHCP after the timeout. The static
+// path assumes each node keeps its address: a lease the server has since
+// given to another host would clash, so reserve the leases on the DHCP
+// server. Swarm IDs come from the chip and do not depend on it.
+#ifndef SWARM_FAST_CONNECT
+#define SWARM_FAST_CONNECT 1
+#endif
+#ifndef SWARM_FAST_STATIC_IP
+#define SWARM_FAST_STATIC_IP 1
+#endif
+#ifndef SWARM_FAST_CONNECT_TIMEOUT_MS
+#define SWARM_FAST_CONNECT_TIMEOUT_MS 3000
+#endif
+
+// After losing the AP the SDK keeps trying to rejoin it by itself; if the
+// link is still down after this long, begin() is re-issued with a full scan
+#ifndef SWARM_WIFI_RETRY_MS
+#define SWARM_WIFI_RETRY_MS 10000
+#endif
+
+// ===== Runtime parameters =====
+// Timing, deadband, hysteresis, TTL and blink settings can be changed on a
+// live node with +++SET_PARAM*** (see swarm_params.h); the build flags here
+// are only the defaults. Changes reach flash SWARM_PARAMS_SAVE_MS after the
+// last one, so a tuning session costs one sector erase, not one per command.
+#ifndef SWARM_PARAMS_SAVE_MS
+#define SWARM_PARAMS_SAVE_MS 5000
+#endif
+
+// ===== Over-the-air update =====
+// +++OTA_UPDATE*** makes one node pull a new image over HTTP. The download
+// runs in SWARM_OTA_CHUNK_BYTES slices from loop(), so the node stays in the
+// swarm until the image has passed its MD5 check; only then does it hand
+// over its role and restart, SWARM_OTA_HANDOVER_MS after telling its peers.
+// SWARM_FW_VERSION names the build and is compared with the offered one.
+// Only the discovered RPi may send the command, and it must carry an
+// HMAC-MD5 over its fields keyed with SWARM_OTA_KEY; the Pi reads the same
+// key from its SWARM_OTA_KEY environment variable. Change it per install.
+// The URL host must be an IP address, and the connect gives up after
+// SWARM_OTA_CONNECT_MS, the one step of the download that blocks.
+#ifndef SWARM_OTA
+#define SWARM_OTA 1
+#endif
+#ifndef SWARM_FW_VERSION
+#define SWARM_FW_VERSION "dev"
+#endif
+#ifndef SWARM_OTA_CHUNK_BYTES
+#define SWARM_OTA_CHUNK_BYTES 1024
+#endif
+#ifndef SWARM_OTA_KEY
+#define SWARM_OTA_KEY "swarm-ota"
+#endif
+#ifndef SWARM_OTA_CONNECT_MS
+#define SWARM_OTA_CONNECT_MS 250
+#endif
+#ifndef SWARM_OTA_STALL_MS
+#define SWARM_OTA_STALL_MS 10000
+#endif
+#ifndef SWARM_OTA_HANDOVER_MS
+#define SWARM_OTA_HANDOVER_MS 300
+#endif
+
+// ===== Node identity =====
+// Nodes identify as the low 16 bits of ESP.getChipId() (the NIC half of the
+// factory MAC, distinct across a batch), so a lease change no longer
+// renumbers a node. -DSWARM_NODE_ID=<0..65535> pins the ID instead, e.g.
+// to resolve a logged id_collision.
+#ifndef SWARM_NODE_ID
+#define SWARM_NODE_ID -1
+#endif
+
+// ===== Timing =====
+#ifndef SWARM_SILENT_MS
+#define SWARM_SILENT_MS 200
+#endif
+#ifndef SWARM_STATUS_PRINT_MS
+#define SWARM_STATUS_PRINT_MS 1000
+#endif
+
+// ===== Reset handling =====
+// After RESET_REQUESTED a node goes dark for the hold time while still
+// draining the socket, then waits a per-node stagger before transmitting so
+// the swarm does not come back in one burst.
+#ifndef SWARM_RESET_HOLD_MS
+#define SWARM_RESET_HOLD_MS 3000
+#endif
+#ifndef SWARM_REJOIN_STAGGER_MS
+#define SWARM_REJOIN_STAGGER_MS 25    // per swarmID step, 16 steps
+#endif
+#ifndef SWARM_CONVERGE_STABLE_MS
+#define SWARM_CONVERGE_STABLE_MS 2000 // no role change for this long = converged
+#endif
+
+// ===== Transmit scheduling =====
+// SILENCE: send once the channel has been quiet for SILENT_MS (original behaviour).
+// JITTER:  SILENT_MS plus a random backoff, so nodes stop firing in lockstep.
+//          A node that loses the race keeps its unused backoff instead of
+//          drawing a new one, so it goes first next time (802.11-style freeze).
+// SLOTTED: TDMA; each node owns slot (ip[3] % SWARM_TDMA_SLOTS) of a fixed frame.
+//          Nodes whose ip[3] leave the same remainder share a slot and collide.
+#define SWARM_TX_SCHED_SILENCE 0
+#define SWARM_TX_SCHED_JITTER  1
+#define SWARM_TX_SCHED_SLOTTED 2
+
+#ifndef SWARM_TX_SCHED
+#define SWARM_TX_SCHED SWARM_TX_SCHED_JITTER
+#endif
+#ifndef SWARM_TX_JITTER_MS
+#define SWARM_TX_JITTER_MS 50
+#endif
+#ifndef SWARM_TDMA_SLOTS
+#define SWARM_TDMA_SLOTS 16
+#endif
+#ifndef SWARM_TDMA_SLOT_MS
+#define SWARM_TDMA_SLOT_MS 15
+#endif
+
+// ===== Deadband reporting =====
+// With a non-zero deadband a node only broadcasts when its reading moved by
+// more than SWARM_DEADBAND since the last frame, plus a keepalive so peers'
+// TTL never fires on a quiet but live node. 0 keeps the broadcast-every-turn
+// behaviour.
+#ifndef SWARM_DEADBAND
+#define SWARM_DEADBAND 0
+#endif
+#ifndef SWARM_KEEPALIVE_MS
+#define SWARM_KEEPALIVE_MS 1000
+#endif
+
+// ===== Election hysteresis =====
+// The MASTER keeps its role until a peer is brighter by more than
+// SWARM_HYSTERESIS counts, and a challenger only claims once it beats the
+// current MASTER by that margin. Either way, a role is held for at least
+// SWARM_ROLE_MIN_HOLD_MS before it can change again.
+#ifndef SWARM_HYSTERESIS
+#define SWARM_HYSTERESIS 8
+#endif
+#ifndef SWARM_ROLE_MIN_HOLD_MS
+#define SWARM_ROLE_MIN_HOLD_MS 1000
+#endif
+
+// ===== ADC acquisition =====
+// The photoresistor is oversampled from a Ticker and filtered in fixed point;
+// the broadcast path only reads the latest filtered value. Keep the period at
+// 5 ms or more: back-to-back analogRead() calls starve the WiFi stack.
+#define SWARM_ADC_FILTER_NONE   0
+#define SWARM_ADC_FILTER_AVG    1  // moving average over SWARM_ADC_AVG_WINDOW samples
+#define SWARM_ADC_FILTER_EMA    2  // EMA with alpha = 1 / 2^SWARM_ADC_EMA_SHIFT
+#define SWARM_ADC_FILTER_MEDIAN 3  // median of the last SWARM_ADC_MEDIAN_N samples
+
+#ifndef SWARM_ADC_FILTER
+#define SWARM_ADC_FILTER SWARM_ADC_FILTER_EMA
+#endif
+#ifndef SWARM_ADC_SAMPLE_MS
+#define SWARM_ADC_SAMPLE_MS 10
+#endif
+#ifndef SWARM_ADC_AVG_WINDOW
+#define SWARM_ADC_AVG_WINDOW 8
+#endif
+#ifndef SWARM_ADC_EMA_SHIFT
+#define SWARM_ADC_EMA_SHIFT 3
+#endif
+#ifndef SWARM_ADC_MEDIAN_N
+#define SWARM_ADC_MEDIAN_N 5
+#endif
+
+// ===== Node table =====
+// Open-addressed table keyed by the peer's IPv4 address. Must be a power of
+// two; keep the load below ~75% of the expected swarm for short probe chains.
+#ifndef SWARM_NODE_TABLE_SIZE
+#define SWARM_NODE_TABLE_SIZE 64
+#endif
+
+// Peers not heard from within the TTL are evicted, so a node that left the
+// swarm cannot hold everyone else in SLAVE. Worst-case failover is roughly
+// TTL + SILENT_MS + one sweep of the table.
+#ifndef SWARM_PEER_TTL_MS
+#define SWARM_PEER_TTL_MS 3000
+#endif
+
+// Send ASCII instead of binary while a legacy peer was heard within this window
+#ifndef SWARM_LEGACY_HOLD_MS
+#define SWARM_LEGACY_HOLD_MS 10000
+#endif
+
+// ===== Master snapshot =====
+// The MASTER forwards the whole peer table to the RPi as one aggregated
+// frame every SWARM_SNAPSHOT_MS; 0 disables it. Frames are capped at
+// SWARM_SNAPSHOT_MAX_BYTES so they never fragment on a 1500-byte MTU.
+#ifndef SWARM_SNAPSHOT_MS
+#define SWARM_SNAPSHOT_MS 1000
+#endif
+#ifndef SWARM_SNAPSHOT_MAX_BYTES
+#define SWARM_SNAPSHOT_MAX_BYTES 1400
+#endif
+
+// ===== Health metrics =====
+// Every node answers +++METRICS_REQUESTED*** with one +++Metrics***
+// datagram of counters and gauges. With SWARM_METRICS_MS above 0 it also
+// pushes one to the RPi on that period.
+#ifndef SWARM_METRICS_MS
+#define SWARM_METRICS_MS 0
+#endif
+
+// ===== Swarm time =====
+// Nodes discipline a swarm clock to the RPi's +++RPI_TIME,<ms>*** beacon, or
+// to the MASTER's frame timestamps while no beacon has been heard for
+// SWARM_SYNC_TTL_MS. Frame timestamps, TDMA slots and history times use it.
+// The reading a node broadcasts is latched at every SWARM_SYNC_EPOCH_MS
+// boundary of swarm time, so an election compares samples taken at the
+// same instant instead of up to a backoff apart. Errors beyond
+// SWARM_SYNC_STEP_MS step the clock instead of slewing it.
+#ifndef SWARM_SYNC
+#define SWARM_SYNC 1
+#endif
+#ifndef SWARM_SYNC_TTL_MS
+#define SWARM_SYNC_TTL_MS 10000
+#endif
+#ifndef SWARM_SYNC_STEP_MS
+#define SWARM_SYNC_STEP_MS 500
+#endif
+#ifndef SWARM_SYNC_DRIFT_WINDOW_MS
+#define SWARM_SYNC_DRIFT_WINDOW_MS 300000
+#endif
+#ifndef SWARM_SYNC_EPOCH_MS
+#define SWARM_SYNC_EPOCH_MS 100
+#endif
+
+// ===== Sample history =====
+// Each node keeps the filtered reading every SWARM_HISTORY_SAMPLE_MS (0 turns
+// history off) in SWARM_HISTORY_BLOCKS delta-encoded blocks of
+// SWARM_HISTORY_BLOCK_BYTES, roughly one byte per sample while the light
+// changes slowly: the defaults hold about 28 minutes in 2 KB. With
+// SWARM_HISTORY_FS=1, evicted blocks are appended to LittleFS, keeping up to
+// twice SWARM_HISTORY_FS_MAX_BYTES. A request is answered with at most
+// SWARM_HISTORY_BURST datagrams.
+#ifndef SWARM_HISTORY_SAMPLE_MS
+#define SWARM_HISTORY_SAMPLE_MS 1000
+#endif
+#ifndef SWARM_HISTORY_BLOCKS
+#define SWARM_HISTORY_BLOCKS 32
+#endif
+#ifndef SWARM_HISTORY_BLOCK_BYTES
+#define SWARM_HISTORY_BLOCK_BYTES 64
+#endif
+#ifndef SWARM_HISTORY_FS
+#define SWARM_HISTORY_FS 0
+#endif
+#ifndef SWARM_HISTORY_FS_MAX_BYTES
+#define SWARM_HISTORY_FS_MAX_BYTES 65536
+#endif
+#ifndef SWARM_HISTORY_BURST
+#define SWARM_HISTORY_BURST 4
+#endif
+
+// ===== LED flashing mapping =====
+// Blink interval (ms) is the line through (X1, Y1) and (X2, Y2), clamped
+#ifndef SWARM_BLINK_X1
+#define SWARM_BLINK_X1 24
+#endif
+#ifndef SWARM_BLINK_Y1
+#define SWARM_BLINK_Y1 2010
+#endif
+#ifndef SWARM_BLINK_X2
+#define SWARM_BLINK_X2 1024
+#endif
+#ifndef SWARM_BLINK_Y2
+#define SWARM_BLINK_Y2 10
+#endif
+#ifndef SWARM_BLINK_MIN_MS
+#define SWARM_BLINK_MIN_MS 5
+#endif
+#ifndef SWARM_BLINK_MAX_MS
+#define SWARM_BLINK_MAX_MS 5000
+#endif
+
+// ===== Serial logging =====
+// Log lines are formatted into a ring buffer and drained only as fast as the
+// UART FIFO accepts them, so a burst never stalls loop(). Lines that do not
+// fit are dropped and counted. SWARM_LOG_LEVEL strips everything above it at
+// compile time: 0 = silent, 1 = events (ROLE, EVENT, NODE_EXPIRED, PROTO),
+// 2 = events plus the periodic STATUS line.
+#define SWARM_LOG_NONE   0
+#define SWARM_LOG_EVENT  1
+#define SWARM_LOG_STATUS 2
+
+#ifndef SWARM_LOG_LEVEL
+#define SWARM_LOG_LEVEL SWARM_LOG_STATUS
+#endif
+#ifndef SWARM_LOG_BUF_BYTES
+#define SWARM_LOG_BUF_BYTES 2048
+#endif
+#ifndef SWARM_LOG_LINE_MAX
+#define SWARM_LOG_LINE_MAX 512
+#endif
+
+// ===== Profiling =====
+// SWARM_PROFILE=1 times the hot loop sections with the CPU cycle counter and
+// dumps min/p50/p99/max every SWARM_PROFILE_DUMP_MS (0 = on request only).
+// With the default 0 every probe compiles to nothing.
+#ifndef SWARM_PROFILE
+#define SWARM_PROFILE 0
+#endif
+#ifndef SWARM_PROFILE_DUMP_MS
+#define SWARM_PROFILE_DUMP_MS 10000
+#endif
+
+// ===== Task scheduling =====
+// loop() runs its work as prioritised tasks: networking, the transmit turn
+// and election, sampling, background jobs, LEDs, then logging. Once a pass
+// has used SWARM_SCHED_PASS_BUDGET_US, the tasks after the election are
+// deferred to the next pass, so a slow flash write or log burst cannot
+// hold up the next receive. Every SWARM_SCHED_REPORT_MS (0 = never) each
+// task logs its runs, overruns, deferrals and worst-case run and gap.
+#ifndef SWARM_SCHED_PASS_BUDGET_US
+#define SWARM_SCHED_PASS_BUDGET_US 4000
+#endif
+#ifndef SWARM_SCHED_LED_MS
+#define SWARM_SCHED_LED_MS 20
+#endif
+#ifndef SWARM_SCHED_REPORT_MS
+#define SWARM_SCHED_REPORT_MS 10000
+#endif
+
+// ===== Power saving =====
+// OFF:   SDK default radio settings and a loop() that never idles (original).
+// MODEM: modem sleep; the radio sleeps between AP beacons, and loop() idles
+//        in delay() until shortly before its next transmit turn.
+// LIGHT: as MODEM, but with WiFi light sleep, so the CPU is also clock-gated
+//        while idle. Pair it with SWARM_TX_SCHED=2: the node then only needs
+//        to be up around its own TDMA slot.
+// Peer frames are buffered by the AP until the next DTIM beacon, so sleeping
+// adds up to one DTIM period of receive latency. A listen interval above 1
+// skips DTIMs and loses peer broadcasts; leave it at 0 unless the TTLs are
+// raised to match.
+#define SWARM_POWER_OFF   0
+#define SWARM_POWER_MODEM 1
+#define SWARM_POWER_LIGHT 2
+
+#ifndef SWARM_POWER_MODE
+#define SWARM_POWER_MODE SWARM_POWER_OFF
+#endif
+#ifndef SWARM_POWER_LISTEN_INTERVAL
+#define SWARM_POWER_LISTEN_INTERVAL 0
+#endif
+// Wake this long before the next turn, so the socket is drained first
+#ifndef SWARM_POWER_WAKE_GUARD_MS
+#define SWARM_POWER_WAKE_GUARD_MS 3
+#endif
+// Longest single idle, keeps the reset and RPi paths responsive
+#ifndef SWARM_POWER_MAX_IDLE_MS
+#define SWARM_POWER_MAX_IDLE_MS 250
+#endif
+
+// ===== Typed constants =====
+constexpr uint16_t UDP_PORT    = SWARM_UDP_PORT;
+constexpr uint16_t RPI_PORT    = SWARM_RPI_PORT;
+constexpr uint32_t RPI_TTL_MS  = SWARM_RPI_TTL_MS;
+constexpr int      MCAST_TTL   = SWARM_MCAST_TTL;
+constexpr uint32_t FAST_CONNECT_TIMEOUT_MS = SWARM_FAST_CONNECT_TIMEOUT_MS;
+constexpr uint32_t WIFI_RETRY_MS = SWARM_WIFI_RETRY_MS;
+constexpr uint32_t PARAMS_SAVE_MS = SWARM_PARAMS_SAVE_MS;
+constexpr size_t   OTA_CHUNK_BYTES  = SWARM_OTA_CHUNK_BYTES;
+constexpr uint32_t OTA_STALL_MS     = SWARM_OTA_STALL_MS;
+constexpr uint32_t OTA_CONNECT_MS   = SWARM_OTA_CONNECT_MS;
+constexpr const char* OTA_KEY       = SWARM_OTA_KEY;
+constexpr uint32_t OTA_HANDOVER_MS  = SWARM_OTA_HANDOVER_MS;
+
+// EEPROM sector layout. commit() rewrites only the bytes given to begin(),
+// so every user must begin() with EEPROM_BYTES or it erases the others.
+constexpr size_t EEPROM_BYTES         = 256;
+constexpr size_t EEPROM_WIFI_OFFSET   = 0;
+constexpr size_t EEPROM_PARAMS_OFFSET = 64;
+
+constexpr uint32_t SILENT_MS       = SWARM_SILENT_MS;
+constexpr uint32_t STATUS_PRINT_MS = SWARM_STATUS_PRINT_MS;
+
+constexpr uint32_t RESET_HOLD_MS      = SWARM_RESET_HOLD_MS;
+constexpr uint32_t REJOIN_STAGGER_MS  = SWARM_REJOIN_STAGGER_MS;
+constexpr uint32_t CONVERGE_STABLE_MS = SWARM_CONVERGE_STABLE_MS;
+
+constexpr uint32_t TX_JITTER_MS   = SWARM_TX_JITTER_MS;
+constexpr uint32_t TDMA_SLOTS     = SWARM_TDMA_SLOTS;
+constexpr uint32_t TDMA_SLOT_MS   = SWARM_TDMA_SLOT_MS;
+constexpr uint32_t TDMA_FRAME_MS  = TDMA_SLOTS * TDMA_SLOT_MS;
+
+constexpr int      DEADBAND     = SWARM_DEADBAND;
+constexpr uint32_t KEEPALIVE_MS = SWARM_KEEPALIVE_MS;
+
+constexpr int      HYSTERESIS       = SWARM_HYSTERESIS;
+constexpr uint32_t ROLE_MIN_HOLD_MS = SWARM_ROLE_MIN_HOLD_MS;
+
+constexpr uint32_t ADC_SAMPLE_MS = SWARM_ADC_SAMPLE_MS;
+
+constexpr uint16_t NODE_TABLE_SIZE = SWARM_NODE_TABLE_SIZE;
+constexpr uint16_t NODE_TABLE_MASK = NODE_TABLE_SIZE - 1;
+constexpr uint32_t PEER_TTL_MS     = SWARM_PEER_TTL_MS;
+constexpr uint32_t LEGACY_HOLD_MS  = SWARM_LEGACY_HOLD_MS;
+
+constexpr uint32_t SNAPSHOT_MS        = SWARM_SNAPSHOT_MS;
+constexpr size_t   SNAPSHOT_MAX_BYTES = SWARM_SNAPSHOT_MAX_BYTES;
+
+constexpr uint32_t METRICS_MS = SWARM_METRICS_MS;
+
+constexpr uint32_t SYNC_TTL_MS          = SWARM_SYNC_TTL_MS;
+constexpr uint32_t SYNC_STEP_MS         = SWARM_SYNC_STEP_MS;
+constexpr uint32_t SYNC_DRIFT_WINDOW_MS = SWARM_SYNC_DRIFT_WINDOW_MS;
+constexpr uint32_t SYNC_EPOCH_MS        = SWARM_SYNC_EPOCH_MS;
+
+constexpr uint32_t HISTORY_SAMPLE_MS     = SWARM_HISTORY_SAMPLE_MS;
+constexpr uint16_t HISTORY_BLOCKS        = SWARM_HISTORY_BLOCKS;
+constexpr size_t   HISTORY_BLOCK_BYTES   = SWARM_HISTORY_BLOCK_BYTES;
+constexpr uint32_t HISTORY_FS_MAX_BYTES  = SWARM_HISTORY_FS_MAX_BYTES;
+constexpr int      HISTORY_BURST         = SWARM_HISTORY_BURST;
+
+constexpr uint16_t LOG_BUF_BYTES = SWARM_LOG_BUF_BYTES;
+constexpr uint16_t LOG_BUF_MASK  = LOG_BUF_BYTES - 1;
+constexpr size_t   LOG_LINE_MAX  = SWARM_LOG_LINE_MAX;
+
+constexpr uint32_t PROFILE_DUMP_MS = SWARM_PROFILE_DUMP_MS;
+
+constexpr uint32_t SCHED_PASS_BUDGET_US = SWARM_SCHED_PASS_BUDGET_US;
+constexpr uint32_t SCHED_LED_MS         = SWARM_SCHED_LED_MS;
+constexpr uint32_t SCHED_REPORT_MS      = SWARM_SCHED_REPORT_MS;
+
+constexpr uint8_t  POWER_LISTEN_INTERVAL = SWARM_POWER_LISTEN_INTERVAL;
+constexpr uint32_t POWER_WAKE_GUARD_MS   = SWARM_POWER_WAKE_GUARD_MS;
+constexpr uint32_t POWER_MAX_IDLE_MS     = SWARM_POWER_MAX_IDLE_MS;
+
+constexpr int BLINK_X1     = SWARM_BLINK_X1;
+constexpr int BLINK_Y1     = SWARM_BLINK_Y1;
+constexpr int BLINK_X2     = SWARM_BLINK_X2;
+constexpr int BLINK_Y2     = SWARM_BLINK_Y2;
+constexpr int BLINK_MIN_MS = SWARM_BLINK_MIN_MS;
+constexpr int BLINK_MAX_MS = SWARM_BLINK_MAX_MS;
+
+// ===== Packet delimiters =====
+constexpr char ESP_START[] = "~~~";
+constexpr char ESP_END[]   = "---";
+constexpr char RPI_START[] = "+++";
+constexpr char RPI_END[]   = "***";
+
+// ===== Sanity checks =====
+static_assert(SWARM_ADC_SAMPLE_MS >= 5, "ADC sampling faster than 5 ms disrupts WiFi");
+static_assert((SWARM_ADC_AVG_WINDOW & (SWARM_ADC_AVG_WINDOW - 1)) == 0, "SWARM_ADC_AVG_WINDOW must be a power of two");
+static_assert(SWARM_ADC_MEDIAN_N % 2 == 1 && SWARM_ADC_MEDIAN_N <= 15, "SWARM_ADC_MEDIAN_N must be odd and at most 15");
+static_assert((NODE_TABLE_SIZE & NODE_TABLE_MASK) == 0, "SWARM_NODE_TABLE_SIZE must be a power of two");
+static_assert(SWARM_KEEPALIVE_MS < SWARM_PEER_TTL_MS, "keepalive must be shorter than the peer TTL");
+static_assert(SWARM_SNAPSHOT_MAX_BYTES >= 64 && SWARM_SNAPSHOT_MAX_BYTES <= 1472, "snapshot must fit one unfragmented datagram");
+static_assert((SWARM_LOG_BUF_BYTES & (SWARM_LOG_BUF_BYTES - 1)) == 0 && SWARM_LOG_BUF_BYTES <= 32768, "SWARM_LOG_BUF_BYTES must be a power of two up to 32768");
+static_assert(SWARM_LOG_LINE_MAX >= 32 && SWARM_LOG_LINE_MAX <= SWARM_LOG_BUF_BYTES, "a log line must fit the ring buffer");
+static_assert(SWARM_NODE_ID >= -1 && SWARM_NODE_ID <= 0xFFFF, "SWARM_NODE_ID must fit the 16-bit frame field");
+static_assert(SWARM_POWER_MODE >= SWARM_POWER_OFF && SWARM_POWER_MODE <= SWARM_POWER_LIGHT, "unknown SWARM_POWER_MODE");
+static_assert(SWARM_POWER_LISTEN_INTERVAL <= 10, "the SDK accepts listen intervals up to 10");
+static_assert(SWARM_SYNC_EPOCH_MS >= SWARM_ADC_SAMPLE_MS, "the sync epoch must span at least one ADC sample");
+static_assert(SWARM_SYNC_DRIFT_WINDOW_MS >= 60000, "drift needs a baseline of at least a minute");
+static_assert(SWARM_OTA_CHUNK_BYTES >= 256 && SWARM_OTA_CHUNK_BYTES <= SWARM_SNAPSHOT_MAX_BYTES, "OTA slices are staged in the snapshot buffer");
+static_assert(sizeof(SWARM_FW_VERSION) <= 16, "SWARM_FW_VERSION is limited to 15 characters");
+static_assert(sizeof(SWARM_OTA_KEY) > 1 && sizeof(SWARM_OTA_KEY) <= 65, "SWARM_OTA_KEY must be 1..64 characters");
+static_assert(SWARM_OTA_CONNECT_MS >= 50 && SWARM_OTA_CONNECT_MS < SWARM_PEER_TTL_MS, "the OTA connect must not outlast the peer TTL");
+static_assert(SWARM_SCHED_PASS_BUDGET_US >= 500 && SWARM_SCHED_PASS_BUDGET_US <= 100000, "SWARM_SCHED_PASS_BUDGET_US must be 500..100000");
+static_assert(SWARM_HISTORY_BLOCKS >= 2, "history needs at least two blocks");
+static_assert(SWARM_HISTORY_BLOCK_BYTES >= 16 && SWARM_HISTORY_BLOCK_BYTES <= 256 && SWARM_HISTORY_BLOCK_BYTES % 4 == 0,
+              "SWARM_HISTORY_BLOCK_BYTES must be a multiple of 4 in 16..256");
+static_assert(SWARM_BLINK_X1 != SWARM_BLINK_X2, "blink mapping needs two distinct x points");
+static_assert(SWARM_BLINK_MIN_MS > 0 && SWARM_BLINK_MIN_MS <= SWARM_BLINK_MAX_MS, "bad blink clamp range");
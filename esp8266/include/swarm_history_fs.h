@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "history.h"
+#include "swarm_config.h"
+
+// ===== History spill to flash =====
+// Blocks evicted from the RAM ring are appended unchanged to HISTORY_FS_FILE.
+// Once it reaches HISTORY_FS_MAX_BYTES it is renamed to HISTORY_FS_OLD and a
+// fresh file is started, so flash keeps one to two files' worth of blocks.
+//
+// Samples still in RAM are lost on a reboot, but their numbers must not be
+// handed out again. Numbers are therefore reserved in HISTORY_FS_SEQ,
+// HISTORY_FS_SEQ_RESERVE at a time and before they are used, and a reboot
+// carries on from the end of the last reservation. Numbers only ever grow,
+// so each file is sorted by sample number.
+
+static const char HISTORY_FS_FILE[] = "/history.bin";
+static const char HISTORY_FS_OLD[]  = "/history.old";
+static const char HISTORY_FS_SEQ[]  = "/history.seq";
+static const uint32_t HISTORY_FS_SEQ_RESERVE = 3600;  // one flash write per 3600 samples
+
+static bool historyFsReady = false;
+static uint32_t historyFsWrites = 0;
+static uint32_t historyFsErrors = 0;
+static uint32_t historyFsSeqLimit = 0;  // first number not yet reserved
+
+static inline bool historyFsReserve(uint32_t from) {
+  uint32_t limit = from + HISTORY_FS_SEQ_RESERVE;
+  File f = LittleFS.open(HISTORY_FS_SEQ, "w");
+  bool ok = f && f.write((const uint8_t*)&limit, sizeof(limit)) == sizeof(limit);
+  if (f) f.close();
+  if (!ok) {
+    historyFsErrors++;
+    return false;
+  }
+  historyFsSeqLimit = limit;
+  return true;
+}
+
+// Call before seq is used
+static inline void historyFsReserveFor(uint32_t seq) {
+  if (historyFsReady && seq >= historyFsSeqLimit) historyFsReserve(seq);
+}
+
+static inline uint32_t historyFsLastEnd(const char* path) {
+  File f = LittleFS.open(path, "r");
+  if (!f) return 0;
+  uint32_t end = 0;
+  size_t records = f.size() / sizeof(HistoryBlock);
+  HistoryBlock b;
+  if (records > 0 && f.seek((uint32_t)((records - 1) * sizeof(b))) &&
+      f.read((uint8_t*)&b, sizeof(b)) == (int)sizeof(b)) {
+    end = b.firstSeq + b.count;
+  }
+  f.close();
+  return end;
+}
+
+// Returns the sample number to continue from (0 on an empty store)
+static inline uint32_t historyFsBegin() {
+  historyFsReady = LittleFS.begin();
+  if (!historyFsReady) return 0;
+
+  const char* path = LittleFS.exists(HISTORY_FS_FILE) ? HISTORY_FS_FILE : HISTORY_FS_OLD;
+  uint32_t next = historyFsLastEnd(path);
+  File f = LittleFS.open(HISTORY_FS_SEQ, "r");
+  uint32_t reserved = 0;
+  if (f && f.read((uint8_t*)&reserved, sizeof(reserved)) == (int)sizeof(reserved) && reserved > next) {
+    next = reserved;
+  }
+  if (f) f.close();
+  historyFsReserve(next);
+  return next;
+}
+
+static inline void historyFsAppend(const HistoryBlock& b) {
+  if (!historyFsReady) return;
+  File f = LittleFS.open(HISTORY_FS_FILE, "a");
+  if (!f) {
+    historyFsErrors++;
+    return;
+  }
+  bool ok = f.write((const uint8_t*)&b, sizeof(b)) == sizeof(b);
+  size_t size = f.size();
+  f.close();
+  if (!ok) {
+    historyFsErrors++;
+    return;
+  }
+  historyFsWrites++;
+
+  if (size >= HISTORY_FS_MAX_BYTES) {
+    LittleFS.remove(HISTORY_FS_OLD);
+    LittleFS.rename(HISTORY_FS_FILE, HISTORY_FS_OLD);
+  }
+}
+
+// Binary search for the first block ending after seq: a request costs about
+// log2(blocks) reads rather than a pass over the file
+static inline bool historyFsFindIn(const char* path, uint32_t seq, HistoryBlock& out) {
+  File f = LittleFS.open(path, "r");
+  if (!f) return false;
+  bool found = false;
+  size_t lo = 0;
+  size_t hi = f.size() / sizeof(HistoryBlock);
+  HistoryBlock b;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (!f.seek((uint32_t)(mid * sizeof(b))) || f.read((uint8_t*)&b, sizeof(b)) != (int)sizeof(b)) break;
+    if (seq < b.firstSeq + b.count) {
+      out = b;
+      found = true;
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  f.close();
+  return found;
+}
+
+// Same contract as historyFind(): the block holding seq, else the next one
+static inline bool historyFsFind(uint32_t seq, HistoryBlock& out) {
+  if (!historyFsReady) return false;
+  return historyFsFindIn(HISTORY_FS_OLD, seq, out) || historyFsFindIn(HISTORY_FS_FILE, seq, out);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+#include "swarm_config.h"
+
+// ===== Buffered serial logging =====
+// logPrintf() formats one line into a static scratch buffer and appends it to
+// a byte ring; logDrain() hands the ring to the UART only as far as
+// Serial.availableForWrite() allows, so nothing here ever waits on the wire.
+// A line is stored whole or not at all, so the output never interleaves.
+//
+// LOG_EVENT()/LOG_STATUS() compile away, arguments included, when
+// SWARM_LOG_LEVEL is below their level.
+
+static char logRing[LOG_BUF_BYTES];
+static char logLine[LOG_LINE_MAX];
+static uint16_t logHead = 0;  // free-running; masked on access
+static uint16_t logTail = 0;
+
+static uint32_t logDropped = 0;    // lines lost because the ring was full
+static uint32_t logTruncated = 0;  // lines cut at LOG_LINE_MAX
+
+static inline uint16_t logUsed() {
+  return (uint16_t)(logHead - logTail);
+}
+
+static inline bool logWrite(const char* s, size_t len) {
+  if (len > (size_t)(LOG_BUF_BYTES - logUsed())) {
+    logDropped++;
+    return false;
+  }
+  uint16_t pos = logHead & LOG_BUF_MASK;
+  size_t first = LOG_BUF_BYTES - pos;
+  if (first > len) first = len;
+  memcpy(logRing + pos, s, first);
+  memcpy(logRing, s + first, len - first);
+  logHead += (uint16_t)len;
+  return true;
+}
+
+static inline __attribute__((format(printf, 1, 2)))
+void logPrintf(const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(logLine, sizeof(logLine), fmt, ap);
+  va_end(ap);
+  if (n <= 0) return;
+
+  size_t len = (size_t)n;
+  if (len >= sizeof(logLine)) {
+    // Keep the line terminated so the next record starts on its own line
+    len = sizeof(logLine) - 1;
+    logLine[len - 1] = '\n';
+    logTruncated++;
+  }
+  logWrite(logLine, len);
+}
+
+// Moves as much of the ring to the UART as fits without blocking
+static inline void logDrain() {
+  int room = Serial.availableForWrite();
+  while (room > 0 && logUsed() > 0) {
+    uint16_t pos = logTail & LOG_BUF_MASK;
+    size_t chunk = LOG_BUF_BYTES - pos;
+    if (chunk > logUsed()) chunk = logUsed();
+    if (chunk > (size_t)room) chunk = (size_t)room;
+    Serial.write((const uint8_t*)(logRing + pos), chunk);
+    logTail += (uint16_t)chunk;
+    room -= (int)chunk;
+  }
+}
+
+#if SWARM_LOG_LEVEL >= SWARM_LOG_EVENT
+#define LOG_EVENT(...) logPrintf(__VA_ARGS__)
+#else
+#define LOG_EVENT(...) ((void)0)
+#endif
+
+#if SWARM_LOG_LEVEL >= SWARM_LOG_STATUS
+#define LOG_STATUS(...) logPrintf(__VA_ARGS__)
+#else
+#define LOG_STATUS(...) ((void)0)
+#endif
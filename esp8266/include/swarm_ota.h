@@ -0,0 +1,258 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD5Builder.h>
+#include <Updater.h>
+#include <WiFiClient.h>
+
+#include "http_head.h"
+#include "swarm_config.h"
+#include "swarm_frame.h"
+
+// ===== Over-the-air update =====
+// HTTP pull into the spare flash half. The command only queues the image;
+// otaPoll() then takes one step per call (connect, request, a slice of the
+// response), so loop() keeps running from the request to the last byte. Update::end() checks
+// the image header and the expected MD5 before it arms the bootloader; a
+// failed check leaves the running firmware as it was.
+//
+// A record in RTC user memory (kept across ESP.restart()) carries the
+// handover time into the new firmware, which reports its downtime once it
+// is broadcasting again.
+
+enum OtaState : uint8_t {
+  OTA_IDLE,
+  OTA_QUEUED,       // waiting for the next poll to connect
+  OTA_REQUESTING,   // request sent, reading the response head
+  OTA_DOWNLOADING,
+  OTA_READY,
+  OTA_FAILED,
+};
+
+enum OtaStart : uint8_t {
+  OTA_STARTED,
+  OTA_ERR_HTTP,     // no connection, or not a 200 with a length
+  OTA_ERR_SPACE,    // image larger than the free sketch space
+  OTA_ERR_UPDATER,  // Update.begin() or a malformed MD5
+};
+
+struct OtaRecord {
+  uint32_t magic;
+  uint32_t handoverSwarmMs;  // swarm time when we stepped down
+  uint32_t handoverLocalMs;  // local time spent between step-down and restart
+  char     version[16];      // image we rebooted into
+  uint16_t crc;
+  uint16_t reserved;
+};
+static_assert(sizeof(OtaRecord) % 4 == 0, "RTC memory is written in 4-byte blocks");
+
+static const uint32_t OTA_RECORD_MAGIC = 0x4F544131;  // "OTA1"
+// After the WiFi cache (blocks 32..39)
+static const uint32_t OTA_RECORD_RTC_BLOCK = 40;
+
+static WiFiClient otaClient;
+static OtaState otaState = OTA_IDLE;
+static OtaStart otaResult = OTA_STARTED;  // why the last start failed
+static char otaUrl[160];
+static char otaHost[16];                  // dotted quad
+static IPAddress otaIp;
+static uint16_t otaPort = 0;
+static const char* otaPath = "/";         // points into otaUrl
+static char otaMd5[33];
+static HttpHead otaHead;
+static uint32_t otaTotal = 0;
+static uint32_t otaWritten = 0;
+static uint32_t otaStartMs = 0;
+static uint32_t otaLastDataMs = 0;
+static uint8_t otaError = 0;  // Update.getError() of the last failure
+
+static inline uint16_t otaRecordCrc(const OtaRecord& r) {
+  return crc16Ccitt((const uint8_t*)&r, offsetof(OtaRecord, crc));
+}
+
+static inline void otaRecordSave(uint32_t handoverSwarmMs, uint32_t handoverLocalMs, const char* version) {
+  OtaRecord r;
+  memset(&r, 0, sizeof(r));
+  r.magic = OTA_RECORD_MAGIC;
+  r.handoverSwarmMs = handoverSwarmMs;
+  r.handoverLocalMs = handoverLocalMs;
+  strncpy(r.version, version, sizeof(r.version) - 1);
+  r.crc = otaRecordCrc(r);
+  ESP.rtcUserMemoryWrite(OTA_RECORD_RTC_BLOCK, (uint32_t*)&r, sizeof(r));
+}
+
+// Reads and clears the record; true if this boot follows an OTA restart
+static inline bool otaRecordTake(OtaRecord& r) {
+  ESP.rtcUserMemoryRead(OTA_RECORD_RTC_BLOCK, (uint32_t*)&r, sizeof(r));
+  bool valid = r.magic == OTA_RECORD_MAGIC && r.crc == otaRecordCrc(r);
+  if (valid) {
+    OtaRecord empty;
+    memset(&empty, 0, sizeof(empty));
+    ESP.rtcUserMemoryWrite(OTA_RECORD_RTC_BLOCK, (uint32_t*)&empty, sizeof(empty));
+    r.version[sizeof(r.version) - 1] = '\0';
+  }
+  return valid;
+}
+
+static inline void otaStartFail(OtaStart r) {
+  otaResult = r;
+  if (Update.isRunning()) Update.end(true);
+  otaClient.stop();
+  otaState = OTA_FAILED;
+}
+
+// Takes the image as the next download; false if the URL is not
+// http://<ip>[:port]/path. Host names are refused because the lookup would
+// block the loop.
+static inline bool otaQueue(const char* url, const char* md5, uint32_t now) {
+  if (strlen(url) >= sizeof(otaUrl) || strlen(md5) != 32) return false;
+  memcpy(otaUrl, url, strlen(url) + 1);
+  if (!httpParseUrl(otaUrl, otaHost, sizeof(otaHost), &otaPort, &otaPath) || !otaIp.fromString(otaHost)) {
+    return false;
+  }
+  memcpy(otaMd5, md5, sizeof(otaMd5));
+  otaTotal = 0;
+  otaWritten = 0;
+  otaError = 0;
+  otaResult = OTA_STARTED;
+  otaStartMs = now;
+  otaState = OTA_QUEUED;
+  return true;
+}
+
+// Connects (for at most OTA_CONNECT_MS) and sends the request
+static inline void otaConnect(uint8_t* buf, size_t bufLen, uint32_t now) {
+  otaClient.setTimeout(OTA_CONNECT_MS);
+  if (!otaClient.connect(otaIp, otaPort)) {
+    otaStartFail(OTA_ERR_HTTP);
+    return;
+  }
+  int n = snprintf((char*)buf, bufLen, "GET %s HTTP/1.0\r\nHost: %s:%u\r\nConnection: close\r\n\r\n",
+                   otaPath, otaHost, (unsigned)otaPort);
+  if (n <= 0 || (size_t)n >= bufLen || otaClient.write(buf, (size_t)n) != (size_t)n) {
+    otaStartFail(OTA_ERR_HTTP);
+    return;
+  }
+  httpHeadInit(otaHead);
+  otaLastDataMs = now;
+  otaState = OTA_REQUESTING;
+}
+
+// Reads the response head as it arrives, then arms the updater
+static inline void otaReadHead(size_t maxBytes, uint32_t now) {
+  int avail = otaClient.available();
+  if (avail <= 0) {
+    if (!otaClient.connected() || now - otaLastDataMs >= OTA_STALL_MS) otaStartFail(OTA_ERR_HTTP);
+    return;
+  }
+  otaLastDataMs = now;
+  HttpHeadResult r = HTTP_HEAD_MORE;
+  for (size_t i = 0; i < (size_t)avail && i < maxBytes && r == HTTP_HEAD_MORE; i++) {
+    r = httpHeadPush(otaHead, (char)otaClient.read());
+  }
+  if (r == HTTP_HEAD_MORE) return;
+
+  if (r == HTTP_HEAD_BAD || otaHead.status != 200 || otaHead.contentLength <= 0) {
+    otaStartFail(OTA_ERR_HTTP);
+  } else if ((uint32_t)otaHead.contentLength > ESP.getFreeSketchSpace()) {
+    otaStartFail(OTA_ERR_SPACE);
+  } else if (!Update.begin((size_t)otaHead.contentLength) || !Update.setMD5(otaMd5)) {
+    otaError = Update.getError();
+    otaStartFail(OTA_ERR_UPDATER);
+  } else {
+    otaTotal = (uint32_t)otaHead.contentLength;
+    otaState = OTA_DOWNLOADING;
+  }
+}
+
+static inline void otaFail() {
+  otaError = Update.getError();
+  if (Update.isRunning()) Update.end(true);  // discard the partial image
+  otaClient.stop();
+  otaState = OTA_FAILED;
+}
+
+// One step per call: the connect, a slice of the head, or a slice of the
+// image staged in buf. READY means the image verified and the next restart
+// boots it. On FAILED, otaResult says whether the start or the download
+// failed.
+static inline OtaState otaPoll(uint8_t* buf, size_t bufLen, uint32_t now) {
+  if (otaState == OTA_QUEUED) {
+    otaConnect(buf, bufLen, now);
+    return otaState;
+  }
+  if (otaState == OTA_REQUESTING) {
+    otaReadHead(bufLen, now);
+    return otaState;
+  }
+  if (otaState != OTA_DOWNLOADING) return otaState;
+  int avail = otaClient.available();
+  if (avail > 0) {
+    size_t want = otaTotal - otaWritten;
+    if (want > bufLen) want = bufLen;
+    if (want > (size_t)avail) want = (size_t)avail;
+    size_t n = otaClient.readBytes(buf, want);
+    if (n > 0 && Update.write(buf, n) != n) {
+      otaFail();
+      return otaState;
+    }
+    otaWritten += (uint32_t)n;
+    otaLastDataMs = now;
+  } else if (now - otaLastDataMs >= OTA_STALL_MS) {
+    otaFail();
+    return otaState;
+  }
+
+  if (otaWritten < otaTotal) return otaState;
+  otaClient.stop();
+  if (!Update.end()) {
+    otaError = Update.getError();
+    otaState = OTA_FAILED;
+  } else {
+    otaState = OTA_READY;
+  }
+  return otaState;
+}
+
+// HMAC-MD5 of msg under SWARM_OTA_KEY, as 32 lower-case hex digits
+static inline void otaAuthToken(const char* msg, size_t n, char out[33]) {
+  uint8_t key[64];
+  memset(key, 0, sizeof(key));
+  memcpy(key, OTA_KEY, strlen(OTA_KEY));
+  uint8_t pad[64];
+  uint8_t inner[16];
+  MD5Builder md5;
+
+  for (size_t i = 0; i < sizeof(pad); i++) pad[i] = key[i] ^ 0x36;
+  md5.begin();
+  md5.add(pad, sizeof(pad));
+  md5.add((const uint8_t*)msg, (uint16_t)n);
+  md5.calculate();
+  md5.getBytes(inner);
+
+  for (size_t i = 0; i < sizeof(pad); i++) pad[i] = key[i] ^ 0x5c;
+  md5.begin();
+  md5.add(pad, sizeof(pad));
+  md5.add(inner, sizeof(inner));
+  md5.calculate();
+  md5.getChars(out);
+}
+
+// Compares every byte, so the time taken says nothing about the token
+static inline bool otaAuthValid(const char* msg, size_t n, const char* token) {
+  char expected[33];
+  otaAuthToken(msg, n, expected);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < 32; i++) diff |= (uint8_t)(expected[i] ^ token[i]);
+  return diff == 0;
+}
+
+static inline const char* otaStartName(OtaStart r) {
+  switch (r) {
+    case OTA_STARTED:     return "downloading";
+    case OTA_ERR_HTTP:    return "http";
+    case OTA_ERR_SPACE:   return "nospace";
+    case OTA_ERR_UPDATER: return "updater";
+  }
+  return "?";
+}
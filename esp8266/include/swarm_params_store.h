@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "swarm_config.h"
+#include "swarm_params.h"
+
+// ===== Parameter persistence =====
+// Runtime parameters live in the EEPROM sector next to the WiFi cache. A
+// missing, corrupt or out-of-range record leaves the build defaults in place.
+
+static_assert(EEPROM_PARAMS_OFFSET + sizeof(ParamsRecord) <= EEPROM_BYTES, "parameters overflow the EEPROM sector");
+
+// Returns true if p was loaded from flash
+static inline bool paramsLoad(SwarmParams& p) {
+  ParamsRecord r;
+  EEPROM.begin(EEPROM_BYTES);
+  EEPROM.get(EEPROM_PARAMS_OFFSET, r);
+  EEPROM.end();
+  return paramsUnpack(r, p);
+}
+
+// Returns true if the flash copy had to be rewritten
+static inline bool paramsStore(const SwarmParams& p) {
+  ParamsRecord r, old;
+  paramsPack(p, r);
+  EEPROM.begin(EEPROM_BYTES);
+  EEPROM.get(EEPROM_PARAMS_OFFSET, old);
+  bool changed = memcmp(&old, &r, sizeof(r)) != 0;
+  if (changed) {
+    EEPROM.put(EEPROM_PARAMS_OFFSET, r);
+    EEPROM.commit();
+  }
+  EEPROM.end();
+  return changed;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "swarm_config.h"
+#include "swarm_log.h"
+
+// ===== Hot-path profiling =====
+// PROF_SCOPE(PROF_X) times the rest of the enclosing block with
+// ESP.getCycleCount() and files the result in a fixed log-linear histogram
+// (4 buckets per power of two, ~19% resolution), so recording is a few
+// instructions and never allocates. The 32-bit counter wraps after ~53 s at
+// 80 MHz, far longer than any section we time.
+//
+// With SWARM_PROFILE=0 the macros expand to nothing and none of the state
+// below exists.
+
+#if SWARM_PROFILE
+
+enum ProfSection : uint8_t {
+  PROF_LOOP,   // one full loop() pass
+  PROF_PARSE,  // dispatching one received datagram
+  PROF_ADC,    // analogRead() plus filter
+  PROF_TX,     // udp.endPacket()
+  PROF_LOG,    // logPrintf() log lines
+  PROF_SECTION_COUNT
+};
+
+static const char* const PROF_NAMES[PROF_SECTION_COUNT] = {
+  "loop", "parse", "adc", "tx", "log"
+};
+
+static const uint8_t PROF_SUB_BITS = 2;
+static const uint8_t PROF_SUB      = 1 << PROF_SUB_BITS;
+// Octaves up to 2^25 cycles (~420 ms at 80 MHz); slower samples land in the last bucket
+static const uint8_t PROF_BUCKETS  = 24 * PROF_SUB;
+
+struct ProfHistogram {
+  uint32_t bucket[PROF_BUCKETS];
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+};
+
+static ProfHistogram profHist[PROF_SECTION_COUNT];
+static uint32_t profLoopCount = 0;
+static uint32_t profWindowStartMs = 0;
+static uint32_t profLastDumpMs = 0;
+static bool profDumpRequested = false;
+
+static inline uint8_t profBucket(uint32_t cycles) {
+  if (cycles < PROF_SUB) return (uint8_t)cycles;
+  uint8_t octave = 31 - __builtin_clz(cycles);
+  uint8_t sub = (cycles >> (octave - PROF_SUB_BITS)) & (PROF_SUB - 1);
+  uint32_t idx = (uint32_t)(octave - PROF_SUB_BITS + 1) * PROF_SUB + sub;
+  return idx < PROF_BUCKETS ? (uint8_t)idx : PROF_BUCKETS - 1;
+}
+
+// Largest cycle count that still maps to bucket idx
+static inline uint32_t profBucketUpper(uint8_t idx) {
+  if (idx < PROF_SUB) return idx;
+  uint8_t octave = idx / PROF_SUB + PROF_SUB_BITS - 1;
+  uint32_t sub = idx % PROF_SUB;
+  return ((PROF_SUB + sub + 1) << (octave - PROF_SUB_BITS)) - 1;
+}
+
+static inline void profRecord(ProfSection s, uint32_t cycles) {
+  ProfHistogram& h = profHist[s];
+  h.bucket[profBucket(cycles)]++;
+  if (h.count == 0 || cycles < h.minCycles) h.minCycles = cycles;
+  if (cycles > h.maxCycles) h.maxCycles = cycles;
+  h.count++;
+}
+
+struct ProfScope {
+  ProfSection section;
+  uint32_t start;
+  explicit ProfScope(ProfSection s) : section(s), start(ESP.getCycleCount()) {}
+  ~ProfScope() { profRecord(section, ESP.getCycleCount() - start); }
+};
+
+// Bucket bound at or above the pct-th percentile, clamped to the observed max
+static uint32_t profPercentile(const ProfHistogram& h, uint8_t pct) {
+  uint32_t rank = (h.count * pct + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < PROF_BUCKETS; i++) {
+    seen += h.bucket[i];
+    if (seen >= rank) {
+      uint32_t upper = profBucketUpper(i);
+      return upper < h.maxCycles ? upper : h.maxCycles;
+    }
+  }
+  return h.maxCycles;
+}
+
+static void profReset(uint32_t now) {
+  memset(profHist, 0, sizeof(profHist));
+  profLoopCount = 0;
+  profWindowStartMs = now;
+}
+
+// Prints one line per section in microseconds, then starts a new window.
+// The dump itself is not profiled.
+static void profDump(uint32_t now) {
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  uint32_t windowMs = now - profWindowStartMs;
+  logPrintf("[%lu] PROFILE window=%lums loops=%lu loop_hz=%lu\n",
+            (unsigned long)now,
+            (unsigned long)windowMs,
+            (unsigned long)profLoopCount,
+            (unsigned long)(windowMs ? (uint64_t)profLoopCount * 1000 / windowMs : 0));
+  for (uint8_t s = 0; s < PROF_SECTION_COUNT; s++) {
+    const ProfHistogram& h = profHist[s];
+    if (h.count == 0) continue;
+    logPrintf("[%lu] PROFILE %-5s n=%lu min=%luus p50=%luus p99=%luus max=%luus\n",
+              (unsigned long)now,
+              PROF_NAMES[s],
+              (unsigned long)h.count,
+              (unsigned long)(h.minCycles / mhz),
+              (unsigned long)(profPercentile(h, 50) / mhz),
+              (unsigned long)(profPercentile(h, 99) / mhz),
+              (unsigned long)(h.maxCycles / mhz));
+  }
+  profReset(now);
+  profLastDumpMs = now;
+}
+
+// Called outside every PROF_SCOPE so a dump never lands in a histogram
+static void profService(uint32_t now) {
+  bool due = PROFILE_DUMP_MS != 0 && now - profLastDumpMs >= PROFILE_DUMP_MS;
+  if (!due && !profDumpRequested) return;
+  profDumpRequested = false;
+  profDump(now);
+}
+
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+#define PROF_SCOPE(section) ProfScope PROF_CONCAT(profScope_, __LINE__)(section)
+#define PROF_LOOP_TICK() (profLoopCount++)
+#define PROF_SERVICE(now) profService(now)
+#define PROF_REQUEST_DUMP() (profDumpRequested = true)
+
+#else
+
+#define PROF_SCOPE(section) ((void)0)
+#define PROF_LOOP_TICK() ((void)0)
+#define PROF_SERVICE(now) ((void)0)
+#define PROF_REQUEST_DUMP() ((void)0)
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <ESP8266WiFi.h>
+
+#include "swarm_config.h"
+#include "swarm_frame.h"
+
+// ===== WiFi fast-connect cache =====
+// The last good BSSID, channel and IP lease, kept in RTC user memory (survives
+// resets and deep sleep) and mirrored to the EEPROM sector (survives power
+// loss). With a valid copy the node joins the known AP on the known channel
+// with the cached address, skipping both the scan and DHCP. The flash copy
+// is only rewritten when something changed, so a stable site never wears it.
+
+static const uint32_t WIFI_CACHE_MAGIC     = 0x57434631;  // "WCF1"
+// In 4-byte RTC user blocks; the first 32 blocks belong to the OTA bootloader
+static const uint32_t WIFI_CACHE_RTC_BLOCK = 32;
+
+struct WifiCache {
+  uint32_t magic;
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint8_t  reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t mask;
+  uint32_t dns;
+  uint16_t ssidCrc;  // a cache for another network is ignored
+  uint16_t crc;      // over everything above
+};
+static_assert(sizeof(WifiCache) % 4 == 0, "RTC memory is written in 4-byte blocks");
+static_assert(EEPROM_WIFI_OFFSET + sizeof(WifiCache) <= EEPROM_PARAMS_OFFSET, "WiFi cache overlaps the parameters");
+
+enum WifiCacheSource : uint8_t { WIFI_CACHE_NONE, WIFI_CACHE_RTC, WIFI_CACHE_FLASH };
+
+static inline uint16_t wifiSsidCrc(const char* ssid) {
+  return crc16Ccitt((const uint8_t*)ssid, strlen(ssid));
+}
+
+static inline uint16_t wifiCacheCrc(const WifiCache& c) {
+  return crc16Ccitt((const uint8_t*)&c, offsetof(WifiCache, crc));
+}
+
+static inline bool wifiCacheValid(const WifiCache& c, const char* ssid) {
+  return c.magic == WIFI_CACHE_MAGIC && c.crc == wifiCacheCrc(c) &&
+         c.ssidCrc == wifiSsidCrc(ssid) && c.channel >= 1 && c.channel <= 14 && c.ip != 0;
+}
+
+static inline WifiCacheSource wifiCacheLoad(WifiCache& c, const char* ssid) {
+  ESP.rtcUserMemoryRead(WIFI_CACHE_RTC_BLOCK, (uint32_t*)&c, sizeof(c));
+  if (wifiCacheValid(c, ssid)) return WIFI_CACHE_RTC;
+
+  EEPROM.begin(EEPROM_BYTES);
+  EEPROM.get(EEPROM_WIFI_OFFSET, c);
+  EEPROM.end();
+  if (wifiCacheValid(c, ssid)) return WIFI_CACHE_FLASH;
+
+  memset(&c, 0, sizeof(c));
+  return WIFI_CACHE_NONE;
+}
+
+// Snapshot of the current association and lease
+static inline void wifiCacheCapture(WifiCache& c, const char* ssid) {
+  memset(&c, 0, sizeof(c));
+  c.magic = WIFI_CACHE_MAGIC;
+  memcpy(c.bssid, WiFi.BSSID(), sizeof(c.bssid));
+  c.channel = (uint8_t)WiFi.channel();
+  c.ip      = (uint32_t)WiFi.localIP();
+  c.gateway = (uint32_t)WiFi.gatewayIP();
+  c.mask    = (uint32_t)WiFi.subnetMask();
+  c.dns     = (uint32_t)WiFi.dnsIP();
+  c.ssidCrc = wifiSsidCrc(ssid);
+  c.crc     = wifiCacheCrc(c);
+}
+
+// Returns true if the flash copy had to be rewritten
+static inline bool wifiCacheStore(const WifiCache& c) {
+  WifiCache old;
+  ESP.rtcUserMemoryRead(WIFI_CACHE_RTC_BLOCK, (uint32_t*)&old, sizeof(old));
+  if (memcmp(&old, &c, sizeof(c)) != 0) {
+    ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_BLOCK, (uint32_t*)&c, sizeof(c));
+  }
+
+  EEPROM.begin(EEPROM_BYTES);
+  EEPROM.get(EEPROM_WIFI_OFFSET, old);
+  bool changed = memcmp(&old, &c, sizeof(c)) != 0;
+  if (changed) {
+    EEPROM.put(EEPROM_WIFI_OFFSET, c);
+    EEPROM.commit();
+  }
+  EEPROM.end();
+  return changed;
+}
@@ -0,0 +1,82 @@
+#include "clock_sync.h"
+
+#include <string.h>
+
+static const uint32_t DRIFT_MIN_BASELINE_MS = 60000;
+static const int32_t  DRIFT_MAX_Q8 = 200 * 256;  // well beyond any crystal
+
+void clockSyncInit(ClockSync& c) {
+  memset(&c, 0, sizeof(c));
+}
+
+uint32_t clockSyncNow(const ClockSync& c, uint32_t local) {
+  if (c.samples == 0) return local;
+  uint32_t dt = local - c.refLocal;
+  int64_t driftMs = (int64_t)dt * c.driftQ8 / (256 * 1000000LL);
+  return c.refSwarm + dt + (uint32_t)(int32_t)driftMs;
+}
+
+SyncSource clockSyncSource(const ClockSync& c, uint32_t local) {
+  if (c.source == SYNC_NONE || local - c.lastSampleLocal >= SYNC_TTL_MS) return SYNC_NONE;
+  return c.source;
+}
+
+static void step(ClockSync& c, SyncSource src, uint32_t remote, uint32_t local) {
+  c.refLocal = local;
+  c.refSwarm = remote;
+  c.phaseFracQ8 = 0;
+  c.driftQ8 = 0;
+  c.anchorLocal = local;
+  c.anchorSwarm = remote;
+  c.pending = false;
+  c.source = src;
+  c.steps++;
+}
+
+static void updateDrift(ClockSync& c, uint32_t local) {
+  uint32_t baseline = local - c.anchorLocal;
+  if (baseline >= DRIFT_MIN_BASELINE_MS) {
+    int32_t skew = (int32_t)(c.refSwarm - c.anchorSwarm) - (int32_t)baseline;
+    int64_t q8 = (int64_t)skew * 256 * 1000000LL / baseline;
+    if (q8 > DRIFT_MAX_Q8) q8 = DRIFT_MAX_Q8;
+    if (q8 < -DRIFT_MAX_Q8) q8 = -DRIFT_MAX_Q8;
+    c.driftQ8 = (int32_t)q8;
+  }
+
+  // Two staggered anchors keep the baseline between one and two windows
+  if (!c.pending && baseline >= SYNC_DRIFT_WINDOW_MS) {
+    c.pendingLocal = local;
+    c.pendingSwarm = c.refSwarm;
+    c.pending = true;
+  } else if (c.pending && local - c.pendingLocal >= SYNC_DRIFT_WINDOW_MS) {
+    c.anchorLocal = c.pendingLocal;
+    c.anchorSwarm = c.pendingSwarm;
+    c.pendingLocal = local;
+    c.pendingSwarm = c.refSwarm;
+  }
+}
+
+bool clockSyncSample(ClockSync& c, SyncSource src, uint32_t remote, uint32_t local) {
+  if (src == SYNC_NONE) return false;
+  SyncSource active = clockSyncSource(c, local);
+  if (src < active) return false;
+
+  int32_t err = (int32_t)(remote - clockSyncNow(c, local));
+  c.lastErrorMs = err;
+  c.lastSampleLocal = local;
+  c.samples++;
+
+  if (c.samples == 1 || src != c.source || err > (int32_t)SYNC_STEP_MS || err < -(int32_t)SYNC_STEP_MS) {
+    step(c, src, remote, local);
+    return true;
+  }
+
+  // Phase: a quarter of the error, remainder carried in Q8
+  int32_t corrQ8 = err * 64 + c.phaseFracQ8;
+  c.refSwarm = clockSyncNow(c, local) + (uint32_t)(corrQ8 >> 8);
+  c.phaseFracQ8 = (uint8_t)(corrQ8 & 0xFF);
+  c.refLocal = local;
+
+  updateDrift(c, local);
+  return true;
+}
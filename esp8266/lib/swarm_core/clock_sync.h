@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "swarm_config.h"
+
+// ===== Swarm clock =====
+// Maps the local millis() onto a shared swarm time taken from reference
+// timestamps: the RPi's time beacon, or the MASTER's frames while no beacon
+// is heard. Every receiver hears the same broadcast at practically the
+// same moment, so nodes agree with each other to within the delivery
+// jitter, whatever the one-way delay is.
+//
+// Phase follows each reference with gain 1/4. Drift is the slope of the
+// corrected phase against the local clock over SYNC_DRIFT_WINDOW_MS and
+// only fills the gaps between references. An error beyond SYNC_STEP_MS
+// (a restarted or new reference) steps the clock and restarts the drift
+// estimate. Nothing here reads a clock.
+
+enum SyncSource : uint8_t {
+  SYNC_NONE   = 0,  // free-running on the local clock
+  SYNC_MASTER = 1,
+  SYNC_RPI    = 2,  // preferred whenever it is fresh
+};
+
+struct ClockSync {
+  uint32_t refLocal;      // last correction, local time
+  uint32_t refSwarm;      // swarm time at refLocal
+  uint8_t  phaseFracQ8;   // sub-millisecond remainder of the phase filter
+  int32_t  driftQ8;       // swarm rate minus local rate, ppm * 256
+
+  uint32_t anchorLocal;   // drift baseline, moved every SYNC_DRIFT_WINDOW_MS
+  uint32_t anchorSwarm;
+  uint32_t pendingLocal;  // next anchor
+  uint32_t pendingSwarm;
+  bool     pending;
+
+  SyncSource source;
+  uint32_t lastSampleLocal;
+  int32_t  lastErrorMs;   // reference minus prediction, before correction
+  uint32_t samples;
+  uint32_t steps;
+};
+
+void clockSyncInit(ClockSync& c);
+
+// Swarm time for a local timestamp; the local time itself until synced
+uint32_t clockSyncNow(const ClockSync& c, uint32_t local);
+
+// Feeds one reference timestamp seen at local time `local`. A source ranked
+// below the current one is ignored while the current one is fresh.
+// Returns true if the sample was used.
+bool clockSyncSample(ClockSync& c, SyncSource src, uint32_t remote, uint32_t local);
+
+// The active source, or SYNC_NONE once it has been silent for SYNC_TTL_MS
+SyncSource clockSyncSource(const ClockSync& c, uint32_t local);
+
+inline int32_t clockSyncDriftPpm(const ClockSync& c) {
+  return c.driftQ8 / 256;
+}
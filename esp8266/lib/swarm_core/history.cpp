@@ -0,0 +1,108 @@
+#include "history.h"
+
+#include <string.h>
+
+static size_t encodeDelta(uint8_t* out, int32_t delta) {
+  uint32_t z = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+  size_t n = 0;
+  while (z >= 0x80) {
+    out[n++] = (uint8_t)(z | 0x80);
+    z >>= 7;
+  }
+  out[n++] = (uint8_t)z;
+  return n;
+}
+
+static size_t decodeDelta(const uint8_t* in, size_t avail, int32_t* delta) {
+  uint32_t z = 0;
+  size_t n = 0;
+  uint8_t shift = 0;
+  while (n < avail) {
+    uint8_t b = in[n++];
+    z |= (uint32_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      *delta = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+      return n;
+    }
+    shift += 7;
+    if (shift > 28) break;
+  }
+  return 0;
+}
+
+void historyInit(HistoryRing& h, uint32_t periodMs, HistoryEvictHook onEvict) {
+  memset(&h, 0, sizeof(h));
+  h.periodMs = periodMs;
+  h.onEvict = onEvict;
+}
+
+static void startBlock(HistoryRing& h, uint16_t value, uint32_t now) {
+  if (h.blocks > 0) {
+    if (++h.newest == HISTORY_BLOCKS) h.newest = 0;
+    if (h.blocks == HISTORY_BLOCKS) {
+      if (h.onEvict) h.onEvict(h.block[h.newest]);
+      h.evicted++;
+    } else {
+      h.blocks++;
+    }
+  } else {
+    h.blocks = 1;
+  }
+
+  HistoryBlock& b = h.block[h.newest];
+  b.firstSeq = h.nextSeq;
+  b.firstMs = now;
+  b.firstValue = value;
+  b.count = 1;
+  b.used = 0;
+}
+
+void historyAppend(HistoryRing& h, uint16_t value, uint32_t now) {
+  HistoryBlock& b = h.block[h.newest];
+  bool extend = h.blocks > 0 && now == b.firstMs + b.count * h.periodMs;
+  if (extend) {
+    uint8_t enc[5];
+    size_t n = encodeDelta(enc, (int32_t)value - (int32_t)h.lastValue);
+    if (b.used + n <= sizeof(b.data)) {
+      memcpy(b.data + b.used, enc, n);
+      b.used += (uint8_t)n;
+      b.count++;
+    } else {
+      extend = false;
+    }
+  }
+  if (!extend) startBlock(h, value, now);
+  h.lastValue = value;
+  h.nextSeq++;
+}
+
+const HistoryBlock* historyBlockAt(const HistoryRing& h, uint16_t i) {
+  if (i >= h.blocks) return nullptr;
+  uint32_t idx = (uint32_t)h.newest + HISTORY_BLOCKS - (h.blocks - 1) + i;
+  return &h.block[idx % HISTORY_BLOCKS];
+}
+
+uint8_t historyDecode(const HistoryBlock& b, uint16_t* out) {
+  if (b.count == 0) return 0;
+  int32_t v = b.firstValue;
+  out[0] = (uint16_t)v;
+  uint8_t n = 1;
+  size_t pos = 0;
+  while (n < b.count && pos < b.used) {
+    int32_t d;
+    size_t used = decodeDelta(b.data + pos, b.used - pos, &d);
+    if (used == 0) break;
+    pos += used;
+    v += d;
+    out[n++] = (uint16_t)v;
+  }
+  return n;
+}
+
+const HistoryBlock* historyFind(const HistoryRing& h, uint32_t seq) {
+  for (uint16_t i = 0; i < h.blocks; i++) {
+    const HistoryBlock* b = historyBlockAt(h, i);
+    if (seq < b->firstSeq + b->count) return b;
+  }
+  return nullptr;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "swarm_config.h"
+
+// ===== Sample history =====
+// Fixed-period samples stored as fixed-size blocks: one absolute sample,
+// then zigzag varint deltas (one byte for steps below 64 counts, two up to
+// the full ADC range). Samples are numbered from boot. A block only ever
+// holds back-to-back periods, so the time of any sample is
+// firstMs + index * periodMs. Like the node table, nothing here reads a clock.
+
+static const size_t HISTORY_HEADER_BYTES = 12;
+static const size_t HISTORY_DATA_BYTES   = HISTORY_BLOCK_BYTES - HISTORY_HEADER_BYTES;
+static const size_t HISTORY_BLOCK_MAX_SAMPLES = 1 + HISTORY_DATA_BYTES;
+
+struct HistoryBlock {
+  uint32_t firstSeq;
+  uint32_t firstMs;
+  uint16_t firstValue;
+  uint8_t  count;  // samples, the first included
+  uint8_t  used;   // bytes of data[] in use
+  uint8_t  data[HISTORY_DATA_BYTES];
+};
+static_assert(sizeof(HistoryBlock) == HISTORY_BLOCK_BYTES, "HistoryBlock must pack to SWARM_HISTORY_BLOCK_BYTES");
+
+// Called with the oldest block just before it is overwritten
+typedef void (*HistoryEvictHook)(const HistoryBlock& b);
+
+struct HistoryRing {
+  HistoryBlock block[HISTORY_BLOCKS];
+  uint16_t newest;     // block being filled
+  uint16_t blocks;     // blocks in use, newest included
+  uint32_t nextSeq;
+  uint16_t lastValue;
+  uint32_t periodMs;
+  uint32_t evicted;
+  HistoryEvictHook onEvict;
+};
+
+void historyInit(HistoryRing& h, uint32_t periodMs, HistoryEvictHook onEvict);
+
+// now is the sample's nominal time; anything but the next period starts a
+// new block
+void historyAppend(HistoryRing& h, uint16_t value, uint32_t now);
+
+// i = 0 is the oldest block; nullptr past the newest
+const HistoryBlock* historyBlockAt(const HistoryRing& h, uint16_t i);
+
+// Expands a block into out[HISTORY_BLOCK_MAX_SAMPLES]; returns the count
+uint8_t historyDecode(const HistoryBlock& b, uint16_t* out);
+
+// The block holding seq, else the first one after it; nullptr if none
+const HistoryBlock* historyFind(const HistoryRing& h, uint32_t seq);
+
+inline bool historyContiguous(const HistoryBlock& a, const HistoryBlock& b, uint32_t periodMs) {
+  return b.firstSeq == a.firstSeq + a.count && b.firstMs == a.firstMs + a.count * periodMs;
+}
@@ -0,0 +1,103 @@
+#include "http_head.h"
+
+#include <string.h>
+
+void httpHeadInit(HttpHead& h) {
+  memset(&h, 0, sizeof(h));
+  h.contentLength = -1;
+}
+
+static bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Case-insensitive prefix match; name is lower case
+static bool hasName(const char* line, uint8_t len, const char* name) {
+  size_t n = strlen(name);
+  if (len < n) return false;
+  for (size_t i = 0; i < n; i++) {
+    char c = line[i];
+    if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    if (c != name[i]) return false;
+  }
+  return true;
+}
+
+// "HTTP/1.x NNN ..."
+static bool parseStatusLine(HttpHead& h) {
+  if (h.lineLen < 12 || memcmp(h.line, "HTTP/1.", 7) != 0 || h.line[8] != ' ') return false;
+  int status = 0;
+  for (uint8_t i = 9; i < 12; i++) {
+    if (!isDigit(h.line[i])) return false;
+    status = status * 10 + (h.line[i] - '0');
+  }
+  h.status = status;
+  return true;
+}
+
+static void parseHeader(HttpHead& h) {
+  static const char name[] = "content-length:";
+  const uint8_t nameLen = sizeof(name) - 1;
+  if (!hasName(h.line, h.lineLen, name)) return;
+
+  uint8_t i = nameLen;
+  while (i < h.lineLen && h.line[i] == ' ') i++;
+  if (i == h.lineLen || !isDigit(h.line[i])) return;
+  int32_t v = 0;
+  for (; i < h.lineLen && isDigit(h.line[i]); i++) {
+    if (v > (INT32_MAX - 9) / 10) return;  // garbage; leave the length unknown
+    v = v * 10 + (h.line[i] - '0');
+  }
+  h.contentLength = v;
+}
+
+HttpHeadResult httpHeadPush(HttpHead& h, char c) {
+  if (++h.bytes > HTTP_HEAD_MAX_BYTES) return HTTP_HEAD_BAD;
+  if (c == '\r') return HTTP_HEAD_MORE;
+  if (c != '\n') {
+    if (h.lineLen < HTTP_HEAD_LINE_MAX) h.line[h.lineLen++] = c;
+    return HTTP_HEAD_MORE;
+  }
+
+  HttpHeadResult r = HTTP_HEAD_MORE;
+  if (h.status == 0) {
+    if (!parseStatusLine(h)) r = HTTP_HEAD_BAD;
+  } else if (h.lineLen == 0) {
+    r = HTTP_HEAD_DONE;
+  } else {
+    parseHeader(h);
+  }
+  h.lineLen = 0;
+  return r;
+}
+
+bool httpParseUrl(const char* url, char* host, size_t hostLen, uint16_t* port, const char** path) {
+  static const char scheme[] = "http://";
+  if (strncmp(url, scheme, sizeof(scheme) - 1) != 0) return false;
+  const char* p = url + sizeof(scheme) - 1;
+
+  const char* hostEnd = p;
+  while (*hostEnd != '\0' && *hostEnd != ':' && *hostEnd != '/') hostEnd++;
+  size_t n = (size_t)(hostEnd - p);
+  if (n == 0 || n >= hostLen) return false;
+  memcpy(host, p, n);
+  host[n] = '\0';
+  p = hostEnd;
+
+  uint32_t portValue = 80;
+  if (*p == ':') {
+    p++;
+    if (!isDigit(*p)) return false;
+    portValue = 0;
+    while (isDigit(*p)) {
+      portValue = portValue * 10 + (uint32_t)(*p++ - '0');
+      if (portValue > 65535) return false;
+    }
+    if (portValue == 0) return false;
+  }
+  if (*p != '\0' && *p != '/') return false;
+
+  *port = (uint16_t)portValue;
+  *path = *p == '\0' ? "/" : p;
+  return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== HTTP response head =====
+// Incremental parser for the status line and headers of an HTTP/1.x
+// response. It takes one byte at a time, so the OTA download can read
+// whatever has arrived and pick up again on the next pass. Only the status
+// code and Content-Length are kept; other header lines are skipped.
+
+enum HttpHeadResult : uint8_t {
+  HTTP_HEAD_MORE,  // needs more bytes
+  HTTP_HEAD_DONE,  // blank line seen; the body starts with the next byte
+  HTTP_HEAD_BAD,   // not an HTTP/1.x response, or a head over HTTP_HEAD_MAX_BYTES
+};
+
+static const uint8_t  HTTP_HEAD_LINE_MAX  = 64;    // the tail of longer lines is dropped
+static const uint16_t HTTP_HEAD_MAX_BYTES = 4096;
+
+struct HttpHead {
+  char     line[HTTP_HEAD_LINE_MAX];
+  uint8_t  lineLen;
+  uint16_t bytes;
+  int      status;         // 0 until the status line is in
+  int32_t  contentLength;  // -1 if not sent
+};
+
+void httpHeadInit(HttpHead& h);
+HttpHeadResult httpHeadPush(HttpHead& h, char c);
+
+// Splits http://<host>[:<port>]<path>. path points into url and is "/" when
+// the URL has none. False for other schemes or a host that does not fit.
+bool httpParseUrl(const char* url, char* host, size_t hostLen, uint16_t* port, const char** path);
@@ -0,0 +1,235 @@
+#include "node_table.h"
+
+#include <string.h>
+
+void nodeTableInit(NodeTable& t, NodeExpireHook onExpire) {
+  memset(&t, 0, sizeof(t));
+  t.leaderSlot = -1;
+  t.masterSlot = -1;
+  t.ttlMs = PEER_TTL_MS;
+  t.onExpire = onExpire;
+}
+
+void nodeTableClear(NodeTable& t) {
+  memset(t.key, 0, sizeof(t.key));
+  t.count = 0;
+  t.leaderSlot = -1;
+  t.leaderDirty = false;
+  t.masterSlot = -1;
+  t.sweepCursor = 0;
+}
+
+static bool slotOutranks(const NodeTable& t, int a, int b) {
+  return outranks(t.reading[a], t.nodeId[a], t.key[a],
+                  t.reading[b], t.nodeId[b], t.key[b]);
+}
+
+static void rescanLeader(NodeTable& t) {
+  t.leaderSlot = -1;
+  for (uint16_t i = 0; i < NODE_TABLE_SIZE; i++) {
+    if (t.key[i] == 0) continue;
+    if (t.leaderSlot < 0 || slotOutranks(t, i, t.leaderSlot)) t.leaderSlot = i;
+  }
+  t.leaderDirty = false;
+}
+
+// Keeps the leader current after slot's entry changed; the previous value
+// only matters when slot was the leader and its reading fell
+static void updateLeader(NodeTable& t, int slot, int prevReading) {
+  if (t.leaderDirty) return;
+  if (t.leaderSlot < 0) {
+    t.leaderSlot = slot;
+  } else if (slot == t.leaderSlot) {
+    if (t.reading[slot] < prevReading) t.leaderDirty = true;
+  } else if (slotOutranks(t, slot, t.leaderSlot)) {
+    t.leaderSlot = slot;
+  }
+}
+
+static void updateMaster(NodeTable& t, int slot, bool claimsMaster) {
+  if (claimsMaster) {
+    if (t.masterSlot < 0 || slot == t.masterSlot || slotOutranks(t, slot, t.masterSlot)) {
+      t.masterSlot = (int16_t)slot;
+    }
+  } else if (slot == t.masterSlot) {
+    t.masterSlot = -1;
+  }
+}
+
+// Sequence accounting for an existing peer. Returns false if the frame is a
+// duplicate or arrived after a newer one and must not overwrite the entry.
+static bool trackSequence(NodeTable& t, int slot, const SwarmFrame& f, uint32_t arrivalMs) {
+  // One-way jitter from sender timestamps (RFC 3550 6.4.1): the clocks need
+  // not agree, only their drift over one inter-arrival interval matters
+  int32_t transit = (int32_t)(arrivalMs - f.timestampMs);
+
+  // Entry last came from an ASCII frame: this frame is the first baseline
+  if (!t.seqValid[slot]) {
+    t.transitMs[slot] = transit;
+    return true;
+  }
+
+  int16_t gap = (int16_t)(f.seq - t.seq[slot]);
+  if (gap == 0) {
+    t.seqDuplicates++;
+    return false;
+  }
+  if (gap < -SEQ_RESYNC_WINDOW || gap > SEQ_RESYNC_WINDOW) {
+    // Peer rebooted or was away long enough to wrap; start counting afresh
+    t.seqResyncs++;
+  } else if (gap < 0) {
+    t.seqReordered++;
+    return false;
+  } else {
+    t.seqLost += (uint32_t)(gap - 1);
+  }
+
+  int32_t d = transit - t.transitMs[slot];
+  if (d < 0) d = -d;
+  if (d > 4095) d = 4095;
+  int32_t j = t.jitterQ4[slot];
+  j += ((d << 4) - j) >> 4;
+  t.jitterQ4[slot] = (uint16_t)j;
+  t.transitMs[slot] = transit;
+  return true;
+}
+
+int nodeTableUpsert(NodeTable& t, uint32_t key, bool* inserted) {
+  uint16_t slot = nodeSlot(key);
+  *inserted = false;
+  for (uint16_t probe = 0; probe < NODE_TABLE_SIZE; probe++) {
+    if (t.key[slot] == key) return slot;
+    if (t.key[slot] == 0) {
+      t.key[slot] = key;
+      t.count++;
+      *inserted = true;
+      return slot;
+    }
+    slot = (slot + 1) & NODE_TABLE_MASK;
+  }
+  t.insertFailures++;
+  return -1;
+}
+
+void nodeTableRemove(NodeTable& t, int slot) {
+  uint16_t hole = (uint16_t)slot;
+  uint16_t j = hole;
+  // Empty the slot first so the scan below terminates even on a full table
+  t.key[hole] = 0;
+  if (t.leaderSlot == (int16_t)slot) {
+    t.leaderSlot = -1;
+    t.leaderDirty = true;
+  }
+  if (t.masterSlot == (int16_t)slot) t.masterSlot = -1;
+
+  for (;;) {
+    j = (j + 1) & NODE_TABLE_MASK;
+    if (t.key[j] == 0) break;
+
+    // Leave entries whose home slot lies cyclically in (hole, j]
+    uint16_t home = nodeSlot(t.key[j]);
+    bool stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+    if (stays) continue;
+
+    t.key[hole]        = t.key[j];
+    t.reading[hole]    = t.reading[j];
+    t.nodeId[hole]     = t.nodeId[j];
+    t.seq[hole]        = t.seq[j];
+    t.seqValid[hole]   = t.seqValid[j];
+    t.lastSeenMs[hole] = t.lastSeenMs[j];
+    t.transitMs[hole]  = t.transitMs[j];
+    t.jitterQ4[hole]   = t.jitterQ4[j];
+    t.key[j] = 0;
+    if (t.leaderSlot == (int16_t)j) t.leaderSlot = (int16_t)hole;
+    if (t.masterSlot == (int16_t)j) t.masterSlot = (int16_t)hole;
+    hole = j;
+  }
+
+  t.count--;
+}
+
+static void expire(NodeTable& t, int slot, uint32_t now) {
+  if (t.onExpire) t.onExpire(t, slot, now);
+  nodeTableRemove(t, slot);
+  t.expired++;
+}
+
+// Only 16 bits of the chip ID go on the wire, so two nodes can share one.
+// Checked once per new address rather than per frame, and only for binary
+// frames: ASCII IDs are ip[3] % 10 and share values by design.
+static void checkIdCollision(NodeTable& t, int slot, uint16_t nodeId, uint32_t now) {
+  for (uint16_t i = 0; i < NODE_TABLE_SIZE; i++) {
+    if ((int)i == slot || t.key[i] == 0 || t.nodeId[i] != nodeId || nodeExpired(t, i, now)) continue;
+    t.idCollisions++;
+    t.collisionKey = t.key[i];
+    return;
+  }
+}
+
+bool nodeTableStore(NodeTable& t, uint32_t key, const SwarmFrame& f, bool legacy, uint32_t now) {
+  bool inserted = false;
+  int slot = nodeTableUpsert(t, key, &inserted);
+  if (slot < 0) return false;
+
+  if (inserted) {
+    // A removed entry may have left data behind in this slot
+    t.reading[slot]   = 0;
+    t.transitMs[slot] = (int32_t)(now - f.timestampMs);
+    t.jitterQ4[slot]  = 0;
+    if (!legacy) checkIdCollision(t, slot, f.nodeId, now);
+  } else if (!legacy && !trackSequence(t, slot, f, now)) {
+    return false;
+  }
+
+  int prevReading = t.reading[slot];
+  t.reading[slot]    = (int16_t)f.reading;
+  t.nodeId[slot]     = f.nodeId;
+  t.seq[slot]        = f.seq;
+  t.seqValid[slot]   = !legacy;
+  t.lastSeenMs[slot] = now;
+  updateLeader(t, slot, inserted ? -1 : prevReading);
+  updateMaster(t, slot, (f.flags & SWARM_FLAG_MASTER) != 0);
+  return true;
+}
+
+void nodeTableSweep(NodeTable& t, uint32_t now) {
+  if (t.count == 0) return;
+  for (uint16_t n = 0; n < TTL_SWEEP_SLOTS; n++) {
+    uint16_t slot = t.sweepCursor;
+    // A removal back-shifts a later entry into this slot, so re-check it
+    if (t.key[slot] != 0 && nodeExpired(t, slot, now)) {
+      expire(t, slot, now);
+      continue;
+    }
+    t.sweepCursor = (t.sweepCursor + 1) & NODE_TABLE_MASK;
+  }
+}
+
+int nodeTableLeader(NodeTable& t, uint32_t now) {
+  for (;;) {
+    if (t.leaderDirty) rescanLeader(t);
+    int slot = t.leaderSlot;
+    if (slot < 0) return -1;
+    if (!nodeExpired(t, slot, now)) return slot;
+    expire(t, slot, now);
+  }
+}
+
+int nodeTableMasterPeer(NodeTable& t, uint32_t now) {
+  int slot = t.masterSlot;
+  if (slot < 0) return -1;
+  if (!nodeExpired(t, slot, now)) return slot;
+  expire(t, slot, now);
+  return -1;
+}
+
+uint32_t nodeTableMeanJitterMs(const NodeTable& t) {
+  uint32_t sum = 0;
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < NODE_TABLE_SIZE; i++) {
+    if (t.key[i] == 0) continue;
+    sum += t.jitterQ4[i];
+    n++;
+  }
+  return n ? (sum / n + 8) >> 4 : 0;
+}
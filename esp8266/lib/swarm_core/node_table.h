@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "swarm_config.h"
+#include "swarm_frame.h"
+
+// ===== Node table =====
+// Open-addressed hash of peers keyed by IPv4 address. Nothing here reads a
+// clock: callers pass `now`, so the same code runs on the device, in native
+// tests and in the simulator.
+
+struct NodeTable;
+
+// Called just before an expired entry is removed (e.g. to log it)
+typedef void (*NodeExpireHook)(const NodeTable& t, int slot, uint32_t now);
+
+// Sequence gaps beyond this are treated as a peer restart, not loss
+static const int16_t SEQ_RESYNC_WINDOW = 1024;
+
+// Slots checked for expiry per sweep; the whole table is covered every
+// NODE_TABLE_SIZE / TTL_SWEEP_SLOTS sweeps
+static const uint16_t TTL_SWEEP_SLOTS = 4;
+
+// Struct-of-arrays: the probe loop only touches key[]
+struct NodeTable {
+  uint32_t key[NODE_TABLE_SIZE];         // IPv4 address, 0 = empty slot
+  int16_t  reading[NODE_TABLE_SIZE];
+  uint16_t nodeId[NODE_TABLE_SIZE];
+  uint16_t seq[NODE_TABLE_SIZE];
+  bool     seqValid[NODE_TABLE_SIZE];    // seq/transitMs hold a binary-frame baseline
+  uint32_t lastSeenMs[NODE_TABLE_SIZE];
+  int32_t  transitMs[NODE_TABLE_SIZE];   // arrival - sender timestamp of the last frame
+  uint16_t jitterQ4[NODE_TABLE_SIZE];    // RFC 3550 inter-arrival jitter, ms * 16
+  uint16_t count;
+
+  // Highest-ranked peer, maintained as readings arrive. Only a drop in the
+  // leader's own reading (or its removal) forces a rescan.
+  int16_t  leaderSlot;                   // -1 = no peers
+  bool     leaderDirty;
+
+  // Peer whose last frame claimed MASTER (best-ranked if several), -1 = none
+  int16_t  masterSlot;
+
+  uint16_t sweepCursor;
+  uint32_t ttlMs;                        // PEER_TTL_MS unless tuned at runtime
+
+  // Counters survive nodeTableClear()
+  uint32_t insertFailures;               // peers dropped because the table was full
+  uint32_t expired;
+  uint32_t seqLost;
+  uint32_t seqDuplicates;
+  uint32_t seqReordered;
+  uint32_t seqResyncs;
+  uint32_t idCollisions;                 // new addresses using a live peer's node ID
+  uint32_t collisionKey;                 // that peer's address, for the last one
+
+  NodeExpireHook onExpire;
+};
+
+// Total order used by the election: higher reading wins, then lower node ID,
+// then lower address, so every node reaches the same decision on ties
+inline bool outranks(int readingA, uint16_t idA, uint32_t keyA,
+                     int readingB, uint16_t idB, uint32_t keyB) {
+  if (readingA != readingB) return readingA > readingB;
+  if (idA != idB) return idA < idB;
+  return keyA < keyB;
+}
+
+inline uint16_t nodeSlot(uint32_t key) {
+  return (uint16_t)((key * 2654435761u) >> 16) & NODE_TABLE_MASK;
+}
+
+inline bool nodeExpired(const NodeTable& t, int slot, uint32_t now) {
+  return now - t.lastSeenMs[slot] > t.ttlMs;
+}
+
+// Zeroes everything, counters included
+void nodeTableInit(NodeTable& t, NodeExpireHook onExpire);
+
+// Forgets every peer; counters and the hook are kept
+void nodeTableClear(NodeTable& t);
+
+// Returns the slot holding key, inserting it if new; -1 if the table is full
+int nodeTableUpsert(NodeTable& t, uint32_t key, bool* inserted);
+
+// Linear-probing delete with backward shift, so lookups never need tombstones
+void nodeTableRemove(NodeTable& t, int slot);
+
+// Records a reading from key. legacy = ASCII frame: no sequence, timestamp
+// or role flag. Returns false if the table is full or the frame was a
+// duplicate / arrived after a newer one.
+bool nodeTableStore(NodeTable& t, uint32_t key, const SwarmFrame& f, bool legacy, uint32_t now);
+
+// Incremental TTL sweep: checks a few slots per call so eviction cost stays
+// flat however large the table is
+void nodeTableSweep(NodeTable& t, uint32_t now);
+
+// Returns the best-ranked live peer, or -1. O(1) unless the leader changed
+// for the worse, in which case one rescan restores the invariant.
+int nodeTableLeader(NodeTable& t, uint32_t now);
+
+// Live peer that last claimed MASTER, or -1
+int nodeTableMasterPeer(NodeTable& t, uint32_t now);
+
+// Mean inter-arrival jitter over stored peers, in ms; O(N)
+uint32_t nodeTableMeanJitterMs(const NodeTable& t);
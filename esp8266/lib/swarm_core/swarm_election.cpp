@@ -0,0 +1,40 @@
+#include "swarm_election.h"
+
+static bool peerOutranksSelf(const NodeTable& t, int slot, const ElectionSelf& self) {
+  return outranks(t.reading[slot], t.nodeId[slot], t.key[slot],
+                  self.reading, self.nodeId, self.key);
+}
+
+// Incumbent and challenger test the same margin on the same advertised
+// values, so the hand-over condition agrees on both sides.
+bool electMaster(NodeTable& t, ElectionState& e, const ElectionSelf& self,
+                 bool isMaster, uint32_t now) {
+  if (e.holding && now - e.roleSinceMs >= e.minHoldMs) e.holding = false;
+
+  int leader = nodeTableLeader(t, now);
+  int masterPeer = nodeTableMasterPeer(t, now);
+
+  if (leader >= 0 && t.reading[leader] == self.reading) e.tieBreaks++;
+  bool outranked = leader >= 0 && peerOutranksSelf(t, leader, self);
+
+  bool wantMaster;
+  if (isMaster) {
+    wantMaster = !(outranked && t.reading[leader] > self.reading + e.hysteresis);
+    // Two MASTERs (e.g. after a partition heals): the lower-ranked one yields
+    if (masterPeer >= 0 && peerOutranksSelf(t, masterPeer, self)) wantMaster = false;
+  } else {
+    wantMaster = !outranked &&
+                 (masterPeer < 0 || self.reading > t.reading[masterPeer] + e.hysteresis);
+  }
+
+  if (wantMaster == isMaster || e.holding) {
+    // Without margin or hold, nobody outranking us means MASTER
+    if (outranked == isMaster) e.flipsSuppressed++;
+    return isMaster;
+  }
+
+  e.roleSinceMs = now;
+  e.holding = true;
+  e.roleChanges++;
+  return wantMaster;
+}
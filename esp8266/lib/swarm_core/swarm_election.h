@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "node_table.h"
+
+// ===== Master election =====
+struct ElectionState {
+  // Minimum hold after a flip. Kept as a start time plus flag rather than a
+  // deadline so the comparison stays valid across the millis() wrap.
+  uint32_t roleSinceMs;
+  bool     holding;
+  uint32_t roleChanges;
+
+  // Elections where a peer tied our reading and the node ID decided the role.
+  // Under the old strict '>' rule each of these left two MASTERs reporting.
+  uint32_t tieBreaks;
+
+  // Elections where the plain ranking called for a flip that the
+  // hysteresis margin or the minimum hold held back
+  uint32_t flipsSuppressed;
+
+  // Build-time values unless tuned at runtime
+  int      hysteresis = HYSTERESIS;
+  uint32_t minHoldMs  = ROLE_MIN_HOLD_MS;
+};
+
+// Our side of the comparison. reading must be the advertised value, not the
+// live one, or nodes would compare different numbers inside the deadband.
+struct ElectionSelf {
+  int      reading;
+  uint16_t nodeId;
+  uint32_t key;
+};
+
+// Election step: O(1) against the tracked leader and current MASTER peer.
+// Returns the role to hold from now on; a flip also starts the minimum hold
+// and counts in e.roleChanges.
+bool electMaster(NodeTable& t, ElectionState& e, const ElectionSelf& self,
+                 bool isMaster, uint32_t now);
@@ -0,0 +1,125 @@
+#include "swarm_frame.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "swarm_config.h"
+
+static inline uint16_t rd16(const uint8_t* p) {
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t rd32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void wr16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void wr32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+uint16_t crc16Ccitt(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+size_t encodeSwarmFrame(uint8_t* buf, const SwarmFrame& f) {
+  buf[0] = SWARM_MAGIC;
+  buf[1] = (uint8_t)((SWARM_VERSION << 4) | (f.flags & SWARM_FLAG_MASTER) | (f.type & SWARM_TYPE_MASK));
+  wr16(buf + 2, f.nodeId);
+  wr16(buf + 4, f.reading);
+  wr16(buf + 6, f.seq);
+  wr32(buf + 8, f.timestampMs);
+  wr16(buf + 12, crc16Ccitt(buf, 12));
+  return SWARM_FRAME_LEN;
+}
+
+bool decodeSwarmFrame(const uint8_t* buf, int len, SwarmFrame* out) {
+  if (!isSwarmFrame(buf, len)) return false;
+  if ((buf[1] >> 4) != SWARM_VERSION) return false;
+  if (rd16(buf + 12) != crc16Ccitt(buf, 12)) return false;
+
+  out->type        = buf[1] & SWARM_TYPE_MASK;
+  out->flags       = buf[1] & SWARM_FLAG_MASTER;
+  out->nodeId      = rd16(buf + 2);
+  out->reading     = rd16(buf + 4);
+  out->seq         = rd16(buf + 6);
+  out->timestampMs = rd32(buf + 8);
+  return true;
+}
+
+const char* framePayload(const char* buf, size_t len,
+                         const char* start, const char* end, size_t* payloadLen) {
+  size_t sl = strlen(start);
+  size_t el = strlen(end);
+  if (len < sl + el) return nullptr;
+  if (memcmp(buf, start, sl) != 0) return nullptr;
+  if (memcmp(buf + len - el, end, el) != 0) return nullptr;
+  *payloadLen = len - sl - el;
+  return buf + sl;
+}
+
+bool parseIntField(const char** p, const char* end, int* out) {
+  const char* c = *p;
+  bool neg = false;
+  if (c < end && *c == '-') {
+    neg = true;
+    c++;
+  }
+  if (c >= end || *c < '0' || *c > '9') return false;
+
+  int v = 0;
+  int digits = 0;
+  while (c < end && *c >= '0' && *c <= '9') {
+    if (++digits > 9) return false;
+    v = v * 10 + (*c - '0');
+    c++;
+  }
+  *out = neg ? -v : v;
+  *p = c;
+  return true;
+}
+
+bool payloadEquals(const char* payload, size_t len, const char* text) {
+  return len == strlen(text) && memcmp(payload, text, len) == 0;
+}
+
+size_t encodeAsciiReading(char* buf, size_t len, uint16_t id, uint16_t reading) {
+  int n = snprintf(buf, len, "%s%u,%u%s", ESP_START, (unsigned)id, (unsigned)reading, ESP_END);
+  return n > 0 && (size_t)n < len ? (size_t)n : 0;
+}
+
+AsciiResult decodeAsciiReading(const char* buf, size_t len, SwarmFrame* out) {
+  size_t n = 0;
+  const char* data = framePayload(buf, len, ESP_START, ESP_END, &n);
+  if (!data) return ASCII_NOT_READING;
+
+  const char* p = data;
+  const char* end = data + n;
+  int rid = -1, rval = -1;
+  if (!parseIntField(&p, end, &rid)) return ASCII_MALFORMED;
+  if (p >= end || *p != ',') return ASCII_MALFORMED;
+  p++;
+  if (!parseIntField(&p, end, &rval) || p != end) return ASCII_MALFORMED;
+
+  if (rid < 0 || rid > 0xFFFF || rval < 0) return ASCII_MALFORMED;
+
+  memset(out, 0, sizeof(*out));
+  out->type    = SWARM_TYPE_READING;
+  out->nodeId  = (uint16_t)rid;
+  out->reading = (uint16_t)rval;
+  return ASCII_READING;
+}
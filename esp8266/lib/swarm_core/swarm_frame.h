@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Binary swarm frame (v1) =====
+// Fixed 14-byte little-endian frame, decoded in place from the UDP buffer:
+//   [0] magic  [1] version<<4 | flags<<3 | type  [2..3] node id  [4..5] reading
+//   [6..7] sequence  [8..11] sender millis  [12..13] CRC-16/CCITT of bytes 0..11
+// The magic byte can never start an ASCII frame, so both formats share the port.
+static const uint8_t SWARM_MAGIC        = 0xA5;
+static const uint8_t SWARM_VERSION      = 1;
+static const uint8_t SWARM_TYPE_READING = 1;
+static const uint8_t SWARM_TYPE_MASK    = 0x07;
+static const uint8_t SWARM_FLAG_MASTER  = 0x08;  // sender currently holds the MASTER role
+static const size_t  SWARM_FRAME_LEN    = 14;
+
+struct SwarmFrame {
+  uint8_t  type;
+  uint8_t  flags;
+  uint16_t nodeId;
+  uint16_t reading;
+  uint16_t seq;
+  uint32_t timestampMs;
+};
+
+uint16_t crc16Ccitt(const uint8_t* data, size_t len);
+
+inline bool isSwarmFrame(const uint8_t* buf, int len) {
+  return len == (int)SWARM_FRAME_LEN && buf[0] == SWARM_MAGIC;
+}
+
+size_t encodeSwarmFrame(uint8_t* buf, const SwarmFrame& f);
+
+// Validates magic, version and CRC; the buffer is never copied
+bool decodeSwarmFrame(const uint8_t* buf, int len, SwarmFrame* out);
+
+// ===== ASCII frames =====
+// Returns the payload between start/end delimiters, or nullptr if the frame does not match
+const char* framePayload(const char* buf, size_t len,
+                         const char* start, const char* end, size_t* payloadLen);
+
+// Bounded decimal parser: consumes [-]digits from *p without reading past end
+bool parseIntField(const char** p, const char* end, int* out);
+
+bool payloadEquals(const char* payload, size_t len, const char* text);
+
+enum AsciiResult : uint8_t {
+  ASCII_NOT_READING,  // not framed as ~~~...---
+  ASCII_MALFORMED,    // framed as a reading but unparseable or out of range
+  ASCII_READING
+};
+
+// ESP -> ESP: ~~~<id>,<reading>---
+// Fills type, nodeId and reading; ASCII frames carry nothing else.
+AsciiResult decodeAsciiReading(const char* buf, size_t len, SwarmFrame* out);
+
+// Baseline firmware numbers nodes ip[3] % 10 and drops ASCII readings whose
+// ID is outside 0..9, so the ASCII path sends this instead of the swarm ID
+static const int MAX_SWARM_LEGACY = 10;
+
+inline uint16_t legacyAsciiId(uint8_t ipLastOctet) {
+  return (uint16_t)(ipLastOctet % MAX_SWARM_LEGACY);
+}
+
+// Writes ~~~<id>,<reading>--- with a trailing NUL; returns the length
+// without it, or 0 if buf is too small
+size_t encodeAsciiReading(char* buf, size_t len, uint16_t id, uint16_t reading);
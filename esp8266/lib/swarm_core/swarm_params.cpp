@@ -0,0 +1,137 @@
+#include "swarm_params.h"
+
+#include <string.h>
+
+#include "swarm_frame.h"
+
+struct ParamInfo {
+  const char* name;
+  uint16_t    offset;
+  int32_t     min;
+  int32_t     max;
+};
+
+#define PARAM(name, field, lo, hi) {name, offsetof(SwarmParams, field), lo, hi}
+
+static const ParamInfo PARAMS[] = {
+  PARAM("silent_ms",     silentMs,      10, 5000),
+  PARAM("tx_jitter_ms",  txJitterMs,    0, 2000),
+  PARAM("deadband",      deadband,      0, 1024),
+  PARAM("keepalive_ms",  keepaliveMs,   100, 60000),
+  PARAM("hysteresis",    hysteresis,    0, 1024),
+  PARAM("role_hold_ms",  roleMinHoldMs, 0, 60000),
+  PARAM("peer_ttl_ms",   peerTtlMs,     500, 60000),
+  PARAM("snapshot_ms",   snapshotMs,    0, 60000),
+  PARAM("status_ms",     statusPrintMs, 500, 600000),
+  PARAM("blink_x1",      blinkX1,       0, 1024),
+  PARAM("blink_y1",      blinkY1,       1, 60000),
+  PARAM("blink_x2",      blinkX2,       0, 1024),
+  PARAM("blink_y2",      blinkY2,       1, 60000),
+  PARAM("blink_min_ms",  blinkMinMs,    1, 60000),
+  PARAM("blink_max_ms",  blinkMaxMs,    1, 60000),
+};
+
+#undef PARAM
+
+static const uint8_t PARAM_COUNT = sizeof(PARAMS) / sizeof(PARAMS[0]);
+static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) * 4 == sizeof(SwarmParams),
+              "every SwarmParams field needs a name");
+
+// Signed and unsigned views of the same 4 bytes may alias
+static int32_t* field(SwarmParams& p, uint8_t i) {
+  return (int32_t*)((uint8_t*)&p + PARAMS[i].offset);
+}
+
+static int32_t fieldValue(const SwarmParams& p, uint8_t i) {
+  return *(const int32_t*)((const uint8_t*)&p + PARAMS[i].offset);
+}
+
+void paramsDefaults(SwarmParams& p) {
+  p.silentMs      = SILENT_MS;
+  p.txJitterMs    = TX_JITTER_MS;
+  p.deadband      = DEADBAND;
+  p.keepaliveMs   = KEEPALIVE_MS;
+  p.hysteresis    = HYSTERESIS;
+  p.roleMinHoldMs = ROLE_MIN_HOLD_MS;
+  p.peerTtlMs     = PEER_TTL_MS;
+  p.snapshotMs    = SNAPSHOT_MS;
+  p.statusPrintMs = STATUS_PRINT_MS;
+  p.blinkX1       = BLINK_X1;
+  p.blinkY1       = BLINK_Y1;
+  p.blinkX2       = BLINK_X2;
+  p.blinkY2       = BLINK_Y2;
+  p.blinkMinMs    = BLINK_MIN_MS;
+  p.blinkMaxMs    = BLINK_MAX_MS;
+}
+
+bool paramsValid(const SwarmParams& p) {
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    int32_t v = fieldValue(p, i);
+    if (v < PARAMS[i].min || v > PARAMS[i].max) return false;
+  }
+  // The build-time rules, plus: a node must get a turn well inside the TTL
+  return p.keepaliveMs < p.peerTtlMs &&
+         p.silentMs + p.txJitterMs < p.peerTtlMs &&
+         p.blinkX1 != p.blinkX2 &&
+         p.blinkMinMs <= p.blinkMaxMs;
+}
+
+uint8_t paramCount() {
+  return PARAM_COUNT;
+}
+
+const char* paramName(uint8_t i) {
+  return i < PARAM_COUNT ? PARAMS[i].name : nullptr;
+}
+
+int32_t paramGet(const SwarmParams& p, uint8_t i) {
+  if (i >= PARAM_COUNT) return 0;
+  return fieldValue(p, i);
+}
+
+int paramFind(const char* name, size_t len) {
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    if (strlen(PARAMS[i].name) == len && memcmp(PARAMS[i].name, name, len) == 0) return i;
+  }
+  return -1;
+}
+
+ParamResult paramSet(SwarmParams& p, uint8_t i, int32_t value) {
+  if (i >= PARAM_COUNT) return PARAM_UNKNOWN;
+  SwarmParams q = p;
+  *field(q, i) = value;
+  if (!paramsValid(q)) return PARAM_RANGE;
+  p = q;
+  return PARAM_OK;
+}
+
+const char* paramResultName(ParamResult r) {
+  switch (r) {
+    case PARAM_OK:      return "ok";
+    case PARAM_UNKNOWN: return "unknown";
+    case PARAM_RANGE:   return "range";
+  }
+  return "?";
+}
+
+static uint16_t recordCrc(const ParamsRecord& r) {
+  return crc16Ccitt((const uint8_t*)&r, offsetof(ParamsRecord, crc));
+}
+
+void paramsPack(const SwarmParams& p, ParamsRecord& out) {
+  memset(&out, 0, sizeof(out));
+  out.magic   = PARAMS_MAGIC;
+  out.version = PARAMS_VERSION;
+  out.size    = sizeof(SwarmParams);
+  out.params  = p;
+  out.crc     = recordCrc(out);
+}
+
+bool paramsUnpack(const ParamsRecord& r, SwarmParams& p) {
+  if (r.magic != PARAMS_MAGIC || r.version != PARAMS_VERSION || r.size != sizeof(SwarmParams)) {
+    return false;
+  }
+  if (r.crc != recordCrc(r) || !paramsValid(r.params)) return false;
+  p = r.params;
+  return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "swarm_config.h"
+
+// ===== Runtime parameters =====
+// The subset of swarm_config.h that can be changed over UDP without a
+// reflash. Build flags give the defaults; values set at runtime persist in
+// flash as a ParamsRecord and win over them at boot. Every field is 4 bytes
+// and never negative, so the name table can address them uniformly.
+
+struct SwarmParams {
+  uint32_t silentMs;
+  uint32_t txJitterMs;
+  int32_t  deadband;
+  uint32_t keepaliveMs;
+  int32_t  hysteresis;
+  uint32_t roleMinHoldMs;
+  uint32_t peerTtlMs;
+  uint32_t snapshotMs;
+  uint32_t statusPrintMs;
+  int32_t  blinkX1;
+  int32_t  blinkY1;
+  int32_t  blinkX2;
+  int32_t  blinkY2;
+  int32_t  blinkMinMs;
+  int32_t  blinkMaxMs;
+};
+
+enum ParamResult : uint8_t {
+  PARAM_OK,
+  PARAM_UNKNOWN,  // no parameter by that name
+  PARAM_RANGE,    // outside its range, or inconsistent with another parameter
+};
+
+static const uint32_t PARAMS_MAGIC   = 0x53505231;  // "SPR1"
+static const uint16_t PARAMS_VERSION = 1;
+
+// Flash image; a record from another build layout is ignored
+struct ParamsRecord {
+  uint32_t    magic;
+  uint16_t    version;
+  uint16_t    size;     // sizeof(SwarmParams) when written
+  SwarmParams params;
+  uint16_t    crc;      // over everything above
+  uint16_t    reserved;
+};
+
+void paramsDefaults(SwarmParams& p);
+
+// Cross-parameter rules (e.g. keepalive below the peer TTL)
+bool paramsValid(const SwarmParams& p);
+
+uint8_t paramCount();
+const char* paramName(uint8_t i);
+int32_t paramGet(const SwarmParams& p, uint8_t i);
+
+// Index of the parameter called name[0..len), or -1
+int paramFind(const char* name, size_t len);
+
+// Applies the value only if it is in range and leaves p valid
+ParamResult paramSet(SwarmParams& p, uint8_t i, int32_t value);
+
+const char* paramResultName(ParamResult r);
+
+void paramsPack(const SwarmParams& p, ParamsRecord& out);
+
+// False (and p untouched) unless the record is intact and valid
+bool paramsUnpack(const ParamsRecord& r, SwarmParams& p);
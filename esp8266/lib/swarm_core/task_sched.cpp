@@ -0,0 +1,82 @@
+#include "task_sched.h"
+
+#include <string.h>
+
+void schedInit(Scheduler& s, uint32_t passBudgetUs, uint8_t criticalPriority, SchedClockUs clockUs) {
+  memset(&s, 0, sizeof(s));
+  s.passBudgetUs = passBudgetUs;
+  s.criticalPriority = criticalPriority;
+  s.clockUs = clockUs;
+}
+
+int schedAdd(Scheduler& s, const char* name, TaskFn fn, uint8_t priority,
+             uint32_t periodMs, uint32_t budgetUs) {
+  if (s.count >= SCHED_MAX_TASKS) return -1;
+
+  // Insertion keeps the table in run order
+  int i = s.count;
+  while (i > 0 && s.task[i - 1].priority > priority) {
+    s.task[i] = s.task[i - 1];
+    i--;
+  }
+  SchedTask& t = s.task[i];
+  memset(&t, 0, sizeof(t));
+  t.name = name;
+  t.fn = fn;
+  t.priority = priority;
+  t.periodMs = periodMs;
+  t.budgetUs = budgetUs;
+  s.count++;
+  return i;
+}
+
+static bool due(const SchedTask& t, uint32_t nowMs) {
+  return t.periodMs == 0 || (int32_t)(nowMs - t.nextMs) >= 0;
+}
+
+static void run(Scheduler& s, SchedTask& t, uint32_t nowMs) {
+  uint32_t start = s.clockUs();
+  if (t.runs > 0) {
+    uint32_t gap = start - t.lastStartUs;
+    if (gap > t.worstGapUs) t.worstGapUs = gap;
+  }
+  t.lastStartUs = start;
+
+  t.fn();
+
+  uint32_t took = s.clockUs() - start;
+  t.runs++;
+  if (took > t.worstUs) t.worstUs = took;
+  if (took > t.budgetUs) t.overruns++;
+  t.deferredPasses = 0;
+  if (t.periodMs != 0) t.nextMs = nowMs + t.periodMs;
+}
+
+void schedRunPass(Scheduler& s, uint32_t nowMs) {
+  uint32_t passStart = s.clockUs();
+  for (uint8_t i = 0; i < s.count; i++) {
+    SchedTask& t = s.task[i];
+    if (!due(t, nowMs)) continue;
+
+    bool spent = s.clockUs() - passStart >= s.passBudgetUs;
+    if (spent && t.priority > s.criticalPriority && t.deferredPasses < SCHED_MAX_DEFERRALS) {
+      t.deferredPasses++;
+      t.deferrals++;
+      continue;
+    }
+    run(s, t, nowMs);
+  }
+
+  uint32_t took = s.clockUs() - passStart;
+  s.passes++;
+  if (took > s.passBudgetUs) s.passOverruns++;
+  if (took > s.worstPassUs) s.worstPassUs = took;
+}
+
+void schedResetWindow(Scheduler& s) {
+  for (uint8_t i = 0; i < s.count; i++) {
+    s.task[i].worstUs = 0;
+    s.task[i].worstGapUs = 0;
+  }
+  s.worstPassUs = 0;
+}
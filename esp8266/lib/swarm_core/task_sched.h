@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Cooperative task scheduler =====
+// loop() is one pass over a short, fixed task list in priority order
+// (0 first). Tasks up to the critical priority run on every pass they are
+// due. Once a pass has used up its budget, the rest are deferred to the
+// next pass, which starts with networking again. The exception is a task
+// deferred SCHED_MAX_DEFERRALS passes in a row, which runs anyway, so slow
+// passes delay background work but cannot starve it.
+//
+// The caller supplies the microsecond clock, so tests can drive it.
+// Counters are cumulative. The worst-case figures cover the window since
+// schedResetWindow().
+
+typedef void (*TaskFn)();
+typedef uint32_t (*SchedClockUs)();
+
+static const uint8_t SCHED_MAX_TASKS = 8;
+static const uint8_t SCHED_MAX_DEFERRALS = 4;
+
+struct SchedTask {
+  const char* name;
+  TaskFn   fn;
+  uint8_t  priority;
+  uint32_t periodMs;     // 0 = every pass
+  uint32_t budgetUs;     // a run longer than this counts as an overrun
+  uint32_t nextMs;
+  uint32_t lastStartUs;
+  uint8_t  deferredPasses;
+
+  uint32_t runs;
+  uint32_t overruns;
+  uint32_t deferrals;
+  uint32_t worstUs;      // longest run in the window
+  uint32_t worstGapUs;   // longest start-to-start gap in the window
+};
+
+struct Scheduler {
+  SchedTask    task[SCHED_MAX_TASKS];  // kept sorted by priority
+  uint8_t      count;
+  uint8_t      criticalPriority;       // priorities <= this are never deferred
+  uint32_t     passBudgetUs;
+  SchedClockUs clockUs;
+
+  uint32_t passes;
+  uint32_t passOverruns;               // passes that ran past passBudgetUs
+  uint32_t worstPassUs;                // in the window
+};
+
+void schedInit(Scheduler& s, uint32_t passBudgetUs, uint8_t criticalPriority, SchedClockUs clockUs);
+
+// Returns the task's index, or -1 if the table is full. Tasks of equal
+// priority run in the order they were added.
+int schedAdd(Scheduler& s, const char* name, TaskFn fn, uint8_t priority,
+             uint32_t periodMs, uint32_t budgetUs);
+
+void schedRunPass(Scheduler& s, uint32_t nowMs);
+
+// Clears the worst-case figures, keeping the counters
+void schedResetWindow(Scheduler& s);
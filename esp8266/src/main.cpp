@@ -1,5 +1,25 @@
 #include <ESP8266WiFi.h>
 #include <WiFiUdp.h>
+#include <Ticker.h>
+
+#include "swarm_config.h"
+#include "clock_sync.h"
+#include "history.h"
+#include "node_table.h"
+#include "swarm_election.h"
+#include "swarm_frame.h"
+#include "swarm_log.h"
+#include "swarm_params.h"
+#include "swarm_params_store.h"
+#include "swarm_profile.h"
+#include "task_sched.h"
+#if SWARM_HISTORY_FS
+#include "swarm_history_fs.h"
+#endif
+#if SWARM_OTA
+#include "swarm_ota.h"
+#endif
+#include "swarm_wifi.h"
 
 // ===== Pins (NodeMCU / ESP8266) =====
 static const uint8_t PHOTORESISTOR_PIN = A0;
@@ -7,44 +27,144 @@ static const uint8_t LED_INDICATOR     = 2;   // GPIO2  (on-board LED, active LO
 static const uint8_t LED_MASTER        = 16;  // GPIO16 (on-board LED, active LOW) steady ON if Master
 
 // ===== WiFi / UDP =====
-const char* ssid     = "TMOBILE";
-const char* password = "Uyen2812";
+const char* ssid     = SWARM_WIFI_SSID;
+const char* password = SWARM_WIFI_PASSWORD;
 
-static const uint16_t UDP_PORT = 4210;
 static const IPAddress BROADCAST_IP(255, 255, 255, 255);
+static const IPAddress SWARM_GROUP(SWARM_MCAST_GROUP);
 WiFiUDP udp;
 
-// ===== Timing =====
-static const uint32_t SILENT_MS = 200;
-static const uint32_t STATUS_PRINT_MS = 1000;
-
-// ===== Packet delimiters =====
-static const char* ESP_START = "~~~";
-static const char* ESP_END   = "---";
-static const char* RPI_START = "+++";
-static const char* RPI_END   = "***";
+// ===== ADC acquisition =====
+Ticker adcTicker;
 
 // ===== Device state =====
-static const int MAX_SWARM = 10;
-
-int swarmID = -1;
+int swarmID = -1;              // short ID, on the wire and in every log line
+uint32_t chipId = 0;           // full 24-bit identity it was taken from
+uint32_t localIpKey = 0;
+uint16_t legacyId = 0;         // ip[3] % MAX_SWARM_LEGACY, the ID in ASCII frames
 int analogValue = 0;
-int readings[MAX_SWARM];
+
+// Written by the ADC ticker, read by loop()
+volatile int filteredValue = 0;
+volatile uint32_t adcSamples = 0;
+NodeTable nodes;
 
 uint32_t lastReceivedTime = 0;
 
+// ===== Runtime parameters =====
+SwarmParams params;
+bool paramsFromFlash = false;
+bool paramsDirty = false;           // changed since the last flash write
+uint32_t paramsChangedMs = 0;
+uint32_t paramSets = 0;
+
+// ===== Transmit scheduler state =====
+uint32_t txHoldoffMs = SILENT_MS;  // silence required before the next send
+uint32_t txLastFrame = 0xFFFFFFFF;  // SLOTTED: last TDMA frame we sent in
+uint8_t txSlot = 0;                 // SLOTTED: our slot in the frame
+uint32_t txSent = 0;
+uint32_t txDeferred = 0;
+
+// Value peers currently hold for us; election must use this, not the live
+// reading, or nodes would compare different numbers inside the deadband
+int advertisedValue = -1;
+uint32_t lastAdvertisedMs = 0;
+uint32_t txSuppressed = 0;
+
+// Last time the expired leader was heard; set until we take over as MASTER
+uint32_t failoverStartMs = 0;
+uint32_t lastFailoverMs = 0;  // latency of our last takeover, 0 = none yet
+uint32_t failovers = 0;
+
+// ===== Election / role change accounting =====
+ElectionState election;
+uint32_t roleChangesThisMinute = 0;
+uint32_t roleChangesLastMinute = 0;
+uint32_t roleMinuteStartMs = 0;
+
+// ===== RPi discovery =====
+// Learned from the source of RESET_REQUESTED or RPI_BEACON
+IPAddress rpiAddress;
+uint32_t rpiLastSeenMs = 0;
+bool rpiKnown = false;
+uint32_t rpiUnicasts = 0;
+uint32_t rpiBroadcasts = 0;
+
+// ===== Health metrics =====
+uint32_t lastMetricsMs = 0;
+uint32_t bootId = 0;  // random per boot, so a collector can tell a reboot from a millis() wrap
+
+// ===== Master snapshot =====
+uint32_t lastSnapshotMs = 0;
+uint32_t snapshotsSent = 0;
+static char snapshotBuf[SNAPSHOT_MAX_BYTES];  // also builds replies and stages OTA slices
+
+// ===== Swarm time =====
+ClockSync swarmClock;
+volatile int epochValue = 0;        // filteredValue at the last epoch boundary
+volatile uint32_t adcEpoch = 0;
+
+// ===== Sample history =====
+HistoryRing history;
+uint32_t historyNextMs = 0;   // nominal time of the next sample
+uint32_t historyReplies = 0;
+
+// ===== Protocol negotiation =====
+uint16_t txSeq = 0;
+bool legacyPeerSeen = false;
+uint32_t lastLegacyRxMs = 0;
+
 // ===== LED flashing mapping (same mapping you used) =====
-static const int X1 = 24;
-static const int Y1 = 2010;
-static const int X2 = 1024;
-static const int Y2 = 10;
+// Blink interval per reading, one entry per 2^INTERVAL_LUT_SHIFT counts.
+// Built from the blink parameters in Q16 fixed point (at compile time for
+// the defaults, again whenever they are tuned), so the hot path is a shift
+// and a load with no runtime math.
+static constexpr uint8_t  INTERVAL_LUT_SHIFT = 2;
+static constexpr uint16_t INTERVAL_LUT_LEN   = (1024 >> INTERVAL_LUT_SHIFT) + 1;
 
-int slope = 0;
-int intercept = 0;
+struct IntervalTable {
+  uint16_t ms[INTERVAL_LUT_LEN];
+};
+
+static constexpr IntervalTable makeIntervalTable(int x1, int y1, int x2, int y2, int minMs, int maxMs) {
+  IntervalTable t{};
+  int64_t slopeQ16 = (int64_t)(y2 - y1) * 65536 / (x2 - x1);
+  for (uint16_t i = 0; i < INTERVAL_LUT_LEN; i++) {
+    int64_t x = (int64_t)i << INTERVAL_LUT_SHIFT;
+    int64_t y = y1 + (((x - x1) * slopeQ16 + 32768) >> 16);
+    if (y < minMs) y = minMs;
+    if (y > maxMs) y = maxMs;
+    t.ms[i] = (uint16_t)(y > 0xFFFF ? 0xFFFF : y);
+  }
+  return t;
+}
+
+static IntervalTable intervalLut =
+    makeIntervalTable(BLINK_X1, BLINK_Y1, BLINK_X2, BLINK_Y2, BLINK_MIN_MS, BLINK_MAX_MS);
 
 // ===== LED states/timers =====
-bool ledIndicatorState = LOW;
-uint32_t ledIndicatorPrevMs = 0;
+// The indicator is toggled by a Ticker, so blink accuracy no longer depends
+// on how busy loop() is. 0 = ticker stopped.
+Ticker ledTicker;
+volatile bool ledIndicatorState = LOW;
+int indicatorValue = -1;
+volatile uint32_t indicatorIntervalMs = 0;  // read by the ticker callback
+bool ledMasterOn = false;  // last level written to LED_MASTER
+
+// ===== Node state machine =====
+enum NodeState : uint8_t {
+  NODE_RUNNING,
+  NODE_RESET_HOLD,  // LEDs off, peer frames discarded
+  NODE_REJOIN,      // listening only, waiting for our stagger slot
+};
+
+NodeState nodeState = NODE_RUNNING;
+uint32_t nodeStateSinceMs = 0;
+uint32_t rejoinDelayMs = 0;
+
+// Reconvergence measurement after a reset; 0 = not measuring
+uint32_t rejoinedAtMs = 0;
+uint32_t lastRoleChangeMs = 0;
 
 // ===== Logging state =====
 bool isMaster = true;
@@ -52,66 +172,1373 @@ bool prevIsMaster = true;
 
 uint32_t lastStatusPrint = 0;
 
+// Lowest free heap seen since boot; should stay flat once the swarm is running
+uint32_t heapLowWatermark = 0xFFFFFFFF;
+
+// ===== Receive buffer =====
+static const size_t RX_BUF_LEN = 255;
+static uint8_t rxBuf[RX_BUF_LEN];
+
+// Datagrams drained per loop() pass before moving on to the election step
+static const int RX_BUDGET_PER_LOOP = 16;
+
+// ===== Receive statistics =====
+uint32_t rxPackets = 0;
+uint32_t rxDropped = 0;     // oversized, malformed or failed CRC
+uint32_t rxBudgetHits = 0;  // passes that stopped with datagrams still queued
+uint32_t rxForeign = 0;     // swarm frames from outside our multicast group
+int rxQueuePeak = 0;        // most datagrams drained in one pass since last STATUS
+uint32_t idCollisions = 0;  // peer frames carrying our own node ID
+
+// ===== Boot timing =====
+uint32_t wifiUpMs = 0;                // millis() when the station got its address
+const char* wifiPath = "scan";        // how it got there: rtc, flash or scan
+bool firstBroadcastLogged = false;
+uint32_t firstBroadcastMs = 0;
+
+// ===== Over-the-air update =====
+bool otaLeaving = false;              // stepped down, restarting into the new image
+#if SWARM_OTA
+IPAddress otaRequester;               // gets the verified/failed outcome
+uint16_t otaRequesterPort = 0;
+char otaVersion[16];
+uint32_t otaHandoverSwarmMs = 0;
+uint32_t otaHandoverLocalMs = 0;
+OtaRecord otaBoot;                    // left by the firmware we replaced
+bool otaReportPending = false;
+#endif
+
+// ===== Loop tasks =====
+// Priority order; everything after PRIO_TURN may be deferred when a pass
+// runs over SCHED_PASS_BUDGET_US. A budget only marks overruns, it never
+// cuts a task short.
+static const uint8_t PRIO_NET        = 0;  // link, reset state, receive
+static const uint8_t PRIO_TURN       = 1;  // transmit turn and election
+static const uint8_t PRIO_SAMPLE     = 2;
+static const uint8_t PRIO_BACKGROUND = 3;  // flash writes, OTA
+static const uint8_t PRIO_LED        = 4;
+static const uint8_t PRIO_LOG        = 5;
+
+static const uint32_t NET_BUDGET_US        = 2000;
+static const uint32_t TURN_BUDGET_US       = 1500;
+static const uint32_t SAMPLE_BUDGET_US     = 500;
+static const uint32_t BACKGROUND_BUDGET_US = 3000;
+static const uint32_t LED_BUDGET_US        = 100;
+static const uint32_t LOG_BUDGET_US        = 1000;
+
+Scheduler sched;
+uint32_t lastSchedReport = 0;
+
+// ===== WiFi link state =====
+// The SDK callbacks only raise flags; updateLink() acts on them in loop()
+WiFiEventHandler wifiGotIpHandler;
+WiFiEventHandler wifiDisconnectedHandler;
+volatile bool wifiDropEvent = false;
+volatile bool wifiUpEvent = false;
+volatile uint8_t wifiDropReason = 0;
+bool linkUp = true;
+uint32_t linkDownSinceMs = 0;
+uint32_t linkLastRetryMs = 0;
+uint32_t linkOutages = 0;
+uint32_t linkLastOutageMs = 0;
+
+// ===== Power accounting =====
+// Awake time is the CPU cycles actually executed over wall time: the cycle
+// counter stops while light sleep clock-gates the CPU, so it measures real
+// sleep rather than the time we asked for.
+uint32_t powerLastCycles = 0;
+uint64_t powerAwakeCycles = 0;
+uint32_t powerWindowStartUs = 0;
+uint32_t powerIdleMs = 0;   // handed to delay() in the current window
+uint32_t awakePct = 100;    // last closed window
+uint32_t idlePct = 0;
+
 static inline uint32_t nowMs() {
   return millis();
 }
 
-static void computeSlopeIntercept(int x1, int y1, int x2, int y2, int* a, int* b) {
-  *a = (y2 - y1) / (x2 - x1);
-  *b = y1 - (*a) * x1;
+// Shared time for timestamps, TDMA slots and sample alignment. Never for
+// durations: it can step.
+static inline uint32_t swarmNowMs() {
+#if SWARM_SYNC
+  return clockSyncNow(swarmClock, nowMs());
+#else
+  return nowMs();
+#endif
 }
 
-static int clampInterval(int intervalMs) {
-  if (intervalMs < 5) return 5;
-  if (intervalMs > 5000) return 5000;
-  return intervalMs;
+static inline bool otaInProgress() {
+#if SWARM_OTA
+  return otaState == OTA_QUEUED || otaState == OTA_REQUESTING || otaState == OTA_DOWNLOADING || otaLeaving;
+#else
+  return false;
+#endif
 }
 
-static void flashIndicatorByReading(int analogVal) {
-  int interval = slope * analogVal + intercept;
-  interval = clampInterval(interval);
+static const char* syncSourceName(SyncSource s) {
+  return s == SYNC_RPI ? "rpi" : (s == SYNC_MASTER ? "master" : "none");
+}
 
-  uint32_t t = nowMs();
-  if (t - ledIndicatorPrevMs >= (uint32_t)interval) {
-    ledIndicatorPrevMs = t;
-    ledIndicatorState = !ledIndicatorState;
-    digitalWrite(LED_INDICATOR, ledIndicatorState);
+static inline uint32_t intervalForReading(int analogVal) {
+  if (analogVal < 0) analogVal = 0;
+  if (analogVal > 1024) analogVal = 1024;
+  return intervalLut.ms[analogVal >> INTERVAL_LUT_SHIFT];
+}
+
+// One-shot: each edge arms the next with the period in effect now, so a
+// period change never restarts the phase or loses a toggle
+static void toggleIndicator() {
+  ledIndicatorState = !ledIndicatorState;
+  digitalWrite(LED_INDICATOR, ledIndicatorState);
+  uint32_t interval = indicatorIntervalMs;
+  if (interval != 0) ledTicker.once_ms(interval, toggleIndicator);
+}
+
+// Starts the ticker if stopped; otherwise the new period applies from the
+// next edge
+static void updateIndicator(int analogVal) {
+  if (analogVal == indicatorValue && indicatorIntervalMs != 0) return;
+  indicatorValue = analogVal;
+
+  uint32_t interval = intervalForReading(analogVal);
+  if (interval == indicatorIntervalMs) return;
+  bool running = indicatorIntervalMs != 0;
+  indicatorIntervalMs = interval;
+  if (!running) ledTicker.once_ms(interval, toggleIndicator);
+}
+
+static void stopIndicator() {
+  indicatorIntervalMs = 0;
+  ledTicker.detach();
+  ledIndicatorState = HIGH;
+  digitalWrite(LED_INDICATOR, HIGH);
+}
+
+// Writes the pin only when the role actually changes
+static void setMasterLed(bool on) {
+  if (on == ledMasterOn) return;
+  ledMasterOn = on;
+  digitalWrite(LED_MASTER, on ? LOW : HIGH);
+}
+
+static constexpr uint8_t log2u(uint32_t v) {
+  return v <= 1 ? 0 : 1 + log2u(v >> 1);
+}
+
+#if SWARM_ADC_FILTER == SWARM_ADC_FILTER_AVG
+static uint16_t adcWindow[SWARM_ADC_AVG_WINDOW];
+static uint8_t adcPos = 0;
+static uint32_t adcSum = 0;
+#elif SWARM_ADC_FILTER == SWARM_ADC_FILTER_EMA
+static int32_t adcEmaQ8 = 0;  // filter state, 8 fractional bits
+#elif SWARM_ADC_FILTER == SWARM_ADC_FILTER_MEDIAN
+static uint16_t adcWindow[SWARM_ADC_MEDIAN_N];
+static uint8_t adcPos = 0;
+#endif
+
+static int adcFilter(int raw, bool first) {
+#if SWARM_ADC_FILTER == SWARM_ADC_FILTER_AVG
+  // Running sum: one add and one subtract per sample
+  if (first) {
+    for (int i = 0; i < SWARM_ADC_AVG_WINDOW; i++) adcWindow[i] = (uint16_t)raw;
+    adcSum = (uint32_t)raw * SWARM_ADC_AVG_WINDOW;
+  }
+  adcSum += (uint32_t)raw - adcWindow[adcPos];
+  adcWindow[adcPos] = (uint16_t)raw;
+  adcPos = (adcPos + 1) & (SWARM_ADC_AVG_WINDOW - 1);
+  return (int)(adcSum >> log2u(SWARM_ADC_AVG_WINDOW));
+#elif SWARM_ADC_FILTER == SWARM_ADC_FILTER_EMA
+  int32_t x = (int32_t)raw << 8;
+  if (first) adcEmaQ8 = x;
+  adcEmaQ8 += (x - adcEmaQ8) >> SWARM_ADC_EMA_SHIFT;
+  return (int)((adcEmaQ8 + 128) >> 8);
+#elif SWARM_ADC_FILTER == SWARM_ADC_FILTER_MEDIAN
+  if (first) {
+    for (int i = 0; i < SWARM_ADC_MEDIAN_N; i++) adcWindow[i] = (uint16_t)raw;
+  }
+  adcWindow[adcPos] = (uint16_t)raw;
+  adcPos = (adcPos + 1) % SWARM_ADC_MEDIAN_N;
+
+  // Insertion sort of a small copy; N <= 15 keeps this a few dozen compares
+  uint16_t sorted[SWARM_ADC_MEDIAN_N];
+  for (int i = 0; i < SWARM_ADC_MEDIAN_N; i++) {
+    uint16_t v = adcWindow[i];
+    int j = i - 1;
+    while (j >= 0 && sorted[j] > v) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = v;
   }
+  return sorted[SWARM_ADC_MEDIAN_N / 2];
+#else
+  (void)first;
+  return raw;
+#endif
+}
+
+// Ticker callback; runs from the SDK timer task, not an interrupt, so
+// analogRead() is safe here
+static void adcSampleTick() {
+  PROF_SCOPE(PROF_ADC);
+  int raw = analogRead(PHOTORESISTOR_PIN);
+  filteredValue = adcFilter(raw, adcSamples == 0);
+  adcSamples++;
+#if SWARM_SYNC
+  uint32_t epoch = swarmNowMs() / SYNC_EPOCH_MS;
+  if (epoch != adcEpoch) {
+    adcEpoch = epoch;
+    epochValue = filteredValue;
+  }
+#endif
+}
+
+static void printNodeExpired(uint16_t nodeId, uint32_t key, int value, uint32_t ageMs) {
+  LOG_EVENT("[%lu] NODE_EXPIRED  id=%u  ip=%u.%u.%u.%u  value=%d  age=%lums\n",
+            (unsigned long)nowMs(),
+            (unsigned)nodeId,
+            (unsigned)(key & 0xFF), (unsigned)((key >> 8) & 0xFF),
+            (unsigned)((key >> 16) & 0xFF), (unsigned)(key >> 24),
+            value,
+            (unsigned long)ageMs);
+}
+
+static void printFailover(uint32_t latencyMs) {
+  LOG_EVENT("[%lu] EVENT failover  id=%d  latency=%lums\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            (unsigned long)latencyMs);
 }
 
 static void printRoleChangeIfNeeded(bool currentIsMaster, int value) {
   if (currentIsMaster == prevIsMaster) return;
   prevIsMaster = currentIsMaster;
+  PROF_SCOPE(PROF_LOG);
 
-  Serial.printf("[%lu] ROLE %s  id=%d  value=%d\n",
-                (unsigned long)nowMs(),
-                currentIsMaster ? "MASTER" : "SLAVE",
-                swarmID,
-                value);
+  // Time from the dead leader's last packet to us taking over
+  if (currentIsMaster && failoverStartMs != 0) {
+    lastFailoverMs = nowMs() - failoverStartMs;
+    failovers++;
+    printFailover(lastFailoverMs);
+    failoverStartMs = 0;
+  }
+
+  LOG_EVENT("[%lu] ROLE %s  id=%d  value=%d\n",
+            (unsigned long)nowMs(),
+            currentIsMaster ? "MASTER" : "SLAVE",
+            swarmID,
+            value);
 }
 
 static void printResetEvent() {
-  Serial.printf("[%lu] EVENT reset_requested_by_rpi  id=%d\n",
-                (unsigned long)nowMs(),
-                swarmID);
+  LOG_EVENT("[%lu] EVENT reset_requested_by_rpi  id=%d\n",
+            (unsigned long)nowMs(),
+            swarmID);
+}
+
+static void powerAccount() {
+  uint32_t c = ESP.getCycleCount();
+  powerAwakeCycles += c - powerLastCycles;
+  powerLastCycles = c;
+}
+
+// Closes the accounting window into awakePct / idlePct
+static void powerCloseWindow() {
+  uint32_t us = micros();
+  uint32_t windowUs = us - powerWindowStartUs;
+  if (windowUs >= 1000) {
+    uint64_t windowCycles = (uint64_t)windowUs * ESP.getCpuFreqMHz();
+    awakePct = (uint32_t)(powerAwakeCycles * 100 / windowCycles);
+    if (awakePct > 100) awakePct = 100;
+    idlePct = (uint32_t)((uint64_t)powerIdleMs * 100000 / windowUs);
+    if (idlePct > 100) idlePct = 100;
+  }
+  powerWindowStartUs = us;
+  powerAwakeCycles = 0;
+  powerIdleMs = 0;
 }
 
 static void printStatusIfDue(bool currentIsMaster, int value) {
   uint32_t t = nowMs();
-  if (t - lastStatusPrint < STATUS_PRINT_MS) return;
+  if (t - lastStatusPrint < params.statusPrintMs) return;
   lastStatusPrint = t;
+  PROF_SCOPE(PROF_LOG);
 
-  Serial.printf("[%lu] STATUS id=%d role=%s value=%d\n",
-                (unsigned long)t,
-                swarmID,
-                currentIsMaster ? "MASTER" : "SLAVE",
-                value);
+  if (t - roleMinuteStartMs >= 60000) {
+    roleChangesLastMinute = roleChangesThisMinute;
+    roleChangesThisMinute = 0;
+    roleMinuteStartMs = t;
+  }
+  powerCloseWindow();
+
+  LOG_STATUS("[%lu] STATUS id=%d role=%s value=%d peers=%u heap=%lu heap_min=%lu "
+             "rx=%lu rx_drop=%lu rx_foreign=%lu rx_peak=%d rx_budget_hits=%lu ties=%lu flips_suppressed=%lu expired=%lu tx=%lu tx_deferred=%lu tx_suppressed=%lu "
+             "flips=%lu flips_last_min=%lu snapshots=%lu rpi=%s "
+             "loss=%lu dup=%lu reorder=%lu jitter=%lums log_drop=%lu awake=%lu%% idle=%lu%% "
+             "wifi_outages=%lu wifi_last_outage=%lums id_collisions=%lu peer_id_collisions=%lu "
+             "sync=%s sync_err=%ldms drift=%ldppm sync_steps=%lu param_sets=%lu\n",
+             (unsigned long)t,
+             swarmID,
+             currentIsMaster ? "MASTER" : "SLAVE",
+             value,
+             (unsigned)nodes.count,
+             (unsigned long)ESP.getFreeHeap(),
+             (unsigned long)heapLowWatermark,
+             (unsigned long)rxPackets,
+             (unsigned long)rxDropped,
+             (unsigned long)rxForeign,
+             rxQueuePeak,
+             (unsigned long)rxBudgetHits,
+             (unsigned long)election.tieBreaks,
+             (unsigned long)election.flipsSuppressed,
+             (unsigned long)nodes.expired,
+             (unsigned long)txSent,
+             (unsigned long)txDeferred,
+             (unsigned long)txSuppressed,
+             (unsigned long)election.roleChanges,
+             (unsigned long)roleChangesLastMinute,
+             (unsigned long)snapshotsSent,
+             rpiKnown ? "unicast" : "broadcast",
+             (unsigned long)nodes.seqLost,
+             (unsigned long)nodes.seqDuplicates,
+             (unsigned long)nodes.seqReordered,
+             (unsigned long)nodeTableMeanJitterMs(nodes),
+             (unsigned long)logDropped,
+             (unsigned long)awakePct,
+             (unsigned long)idlePct,
+             (unsigned long)linkOutages,
+             (unsigned long)linkLastOutageMs,
+             (unsigned long)idCollisions,
+             (unsigned long)nodes.idCollisions,
+             syncSourceName(clockSyncSource(swarmClock, t)),
+             (long)swarmClock.lastErrorMs,
+             (long)clockSyncDriftPpm(swarmClock),
+             (unsigned long)swarmClock.steps,
+             (unsigned long)paramSets);
+  rxQueuePeak = 0;
+}
+
+static void printProtocolChange(bool legacy) {
+  LOG_EVENT("[%lu] PROTO tx=%s  id=%d\n",
+            (unsigned long)nowMs(),
+            legacy ? "ASCII" : "BINARY",
+            swarmID);
+}
+
+// Legacy peers only parse ASCII, so fall back while any of them is still around
+static bool useLegacyTx() {
+  bool legacy = lastLegacyRxMs != 0 && nowMs() - lastLegacyRxMs < LEGACY_HOLD_MS;
+  if (legacy != legacyPeerSeen) {
+    legacyPeerSeen = legacy;
+    printProtocolChange(legacy);
+  }
+  return legacy;
+}
+
+// Slots follow the address rather than the chip ID: DHCP hands out
+// neighbouring addresses, which spread across slots, while chip IDs are
+// effectively random modulo the slot count
+static void txAssignSlot(const IPAddress& ip) {
+  txSlot = (uint8_t)(ip[3] % TDMA_SLOTS);
+}
+
+static void txRedrawHoldoff() {
+#if SWARM_TX_SCHED == SWARM_TX_SCHED_JITTER
+  txHoldoffMs = params.silentMs + (uint32_t)random((long)params.txJitterMs + 1);
+#else
+  txHoldoffMs = params.silentMs;
+#endif
+}
+
+// A peer transmitted while we were waiting for our turn. Called before
+// lastReceivedTime is refreshed.
+static void txOnPeerPacket() {
+#if SWARM_TX_SCHED == SWARM_TX_SCHED_SLOTTED
+  // Someone else is using our slot (address collision modulo the slot count):
+  // skip this frame half the time so the pair drifts apart
+  uint32_t t = swarmNowMs();
+  uint32_t frame = t / TDMA_FRAME_MS;
+  uint32_t slotStart = (uint32_t)txSlot * TDMA_SLOT_MS;
+  uint32_t offset = t % TDMA_FRAME_MS;
+  if (frame != txLastFrame && offset >= slotStart && offset < slotStart + TDMA_SLOT_MS &&
+      random(2) == 0) {
+    txLastFrame = frame;
+    txDeferred++;
+  }
+#else
+  // Only count it when the peer beat us inside our backoff window
+  uint32_t waited = nowMs() - lastReceivedTime;
+  if (waited <= params.silentMs) return;
+  txDeferred++;
+  // Keep the backoff we had not used up yet. Redrawing (or widening) it here
+  // lets the last sender win every round and starves the rest past PEER_TTL_MS.
+  uint32_t used = waited - params.silentMs;
+  txHoldoffMs = used < txHoldoffMs - params.silentMs ? txHoldoffMs - used : params.silentMs;
+#endif
+}
+
+static bool txDue() {
+#if SWARM_TX_SCHED == SWARM_TX_SCHED_SLOTTED
+  uint32_t t = swarmNowMs();
+  uint32_t frame = t / TDMA_FRAME_MS;
+  if (frame == txLastFrame) return false;
+  uint32_t slotStart = (uint32_t)txSlot * TDMA_SLOT_MS;
+  uint32_t offset = t % TDMA_FRAME_MS;
+  return offset >= slotStart && offset < slotStart + TDMA_SLOT_MS;
+#else
+  return nowMs() - lastReceivedTime > txHoldoffMs;
+#endif
+}
+
+// Milliseconds until txDue() turns true; 0 if it already is
+static uint32_t txTimeToTurn() {
+#if SWARM_TX_SCHED == SWARM_TX_SCHED_SLOTTED
+  uint32_t t = swarmNowMs();
+  uint32_t frame = t / TDMA_FRAME_MS;
+  uint32_t slotStart = (uint32_t)txSlot * TDMA_SLOT_MS;
+  uint32_t offset = t % TDMA_FRAME_MS;
+  if (frame == txLastFrame || offset >= slotStart + TDMA_SLOT_MS) {
+    return TDMA_FRAME_MS - offset + slotStart;
+  }
+  return offset < slotStart ? slotStart - offset : 0;
+#else
+  uint32_t waited = nowMs() - lastReceivedTime;
+  return waited > txHoldoffMs ? 0 : txHoldoffMs + 1 - waited;
+#endif
+}
+
+static bool txNeeded(int value) {
+  if (params.deadband <= 0 || advertisedValue < 0) return true;
+  if (nowMs() - lastAdvertisedMs >= params.keepaliveMs) return true;
+  int delta = value - advertisedValue;
+  if (delta < 0) delta = -delta;
+  return delta > params.deadband;
+}
+
+// Called once per scheduled turn, whether or not the deadband let us send
+static void txOnTurn() {
+  txLastFrame = swarmNowMs() / TDMA_FRAME_MS;
+  txRedrawHoldoff();
+}
+
+// Expiry hook for the node table
+static void onNodeExpired(const NodeTable& t, int slot, uint32_t now) {
+  if (slot == t.leaderSlot) failoverStartMs = t.lastSeenMs[slot];
+  printNodeExpired(t.nodeId[slot], t.key[slot], t.reading[slot], now - t.lastSeenMs[slot]);
+}
+
+static void printIdCollision(uint32_t srcIp) {
+  IPAddress ip(srcIp);
+  LOG_EVENT("[%lu] EVENT id_collision  id=%d  peer=%d.%d.%d.%d\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            ip[0], ip[1], ip[2], ip[3]);
+}
+
+static void printPeerIdCollision(uint16_t peerId, uint32_t srcIp, uint32_t otherIp) {
+  IPAddress a(srcIp);
+  IPAddress b(otherIp);
+  LOG_EVENT("[%lu] EVENT peer_id_collision  id=%d  peer_id=%u  peer=%d.%d.%d.%d  other=%d.%d.%d.%d\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            (unsigned)peerId,
+            a[0], a[1], a[2], a[3],
+            b[0], b[1], b[2], b[3]);
+}
+
+static void printClockStep(SyncSource src, int32_t errMs) {
+  LOG_EVENT("[%lu] EVENT clock_step  id=%d  source=%s  error=%ldms\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            syncSourceName(src),
+            (long)errMs);
+}
+
+static void noteSwarmTime(SyncSource src, uint32_t remoteMs) {
+  uint32_t steps = swarmClock.steps;
+  if (!clockSyncSample(swarmClock, src, remoteMs, nowMs())) return;
+  if (swarmClock.steps != steps) printClockStep(src, swarmClock.lastErrorMs);
+}
+
+// legacy = ASCII frame: no sequence, timestamp or role flag
+static void storeReading(uint32_t srcIp, const SwarmFrame& f, bool legacy) {
+  if (srcIp == 0 || srcIp == localIpKey) return;
+  // Elections still resolve (ties fall back to the address), but the RPi
+  // would merge both nodes into one LED
+  // ASCII frames carry ip[3] % 10, which says nothing about the swarm ID
+  if (!legacy && f.nodeId == (uint16_t)swarmID) {
+    if (idCollisions++ == 0) printIdCollision(srcIp);
+  }
+  if (f.reading > 1024) return;
+  // Peers are still flushing pre-reset state; the table refills after the hold
+  if (nodeState == NODE_RESET_HOLD) return;
+
+  uint32_t collisions = nodes.idCollisions;
+  bool stored = nodeTableStore(nodes, srcIp, f, legacy, nowMs());
+  if (nodes.idCollisions != collisions) printPeerIdCollision(f.nodeId, srcIp, nodes.collisionKey);
+  if (!stored) return;
+#if SWARM_SYNC
+  if (!legacy && (f.flags & SWARM_FLAG_MASTER)) noteSwarmTime(SYNC_MASTER, f.timestampMs);
+#endif
+  txOnPeerPacket();
+  lastReceivedTime = nowMs();
+}
+
+static bool runElection() {
+  uint32_t now = nowMs();
+  // While ASCII peers are around they know us by the legacy ID, and ties
+  // must break the same way on every node
+  uint16_t selfId = legacyPeerSeen ? legacyId : (uint16_t)swarmID;
+  ElectionSelf self = {advertisedValue, selfId, localIpKey};
+  bool role = electMaster(nodes, election, self, isMaster, now);
+  if (role != isMaster) {
+    lastRoleChangeMs = now;
+    roleChangesThisMinute++;
+  }
+  return role;
+}
+
+static bool handleAsciiReading(uint32_t srcIp, const char* buf, size_t len) {
+  SwarmFrame f;
+  AsciiResult res = decodeAsciiReading(buf, len, &f);
+  if (res == ASCII_NOT_READING) return false;
+  if (res == ASCII_MALFORMED) return true;
+
+  storeReading(srcIp, f, true);
+  lastLegacyRxMs = nowMs();
+  return true;
+}
+
+static void enterState(NodeState s) {
+  nodeState = s;
+  nodeStateSinceMs = nowMs();
+}
+
+static void handleResetRequest() {
+  // A repeated request inside the hold window must not extend it
+  if (nodeState == NODE_RESET_HOLD) return;
+
+  // Turn both LEDs OFF immediately (active LOW)
+  stopIndicator();
+  setMasterLed(false);
+
+  // Reset state
+  isMaster = true;
+  prevIsMaster = true;
+  nodeTableClear(nodes);
+  failoverStartMs = 0;
+  advertisedValue = -1;
+  election.holding = false;
+
+  printResetEvent();
+  enterState(NODE_RESET_HOLD);
+}
+
+static void printRpiDiscovered(const IPAddress& ip) {
+  LOG_EVENT("[%lu] EVENT rpi_discovered  ip=%d.%d.%d.%d  port=%u\n",
+            (unsigned long)nowMs(),
+            ip[0], ip[1], ip[2], ip[3],
+            RPI_PORT);
+}
+
+static void noteRpiAddress(uint32_t srcIp) {
+  IPAddress ip(srcIp);
+  bool changed = !rpiKnown || (uint32_t)rpiAddress != srcIp;
+  rpiAddress = ip;
+  rpiLastSeenMs = nowMs();
+  rpiKnown = true;
+  if (changed) printRpiDiscovered(ip);
+}
+
+static bool rpiReachable() {
+  if (!rpiKnown) return false;
+  if (nowMs() - rpiLastSeenMs <= RPI_TTL_MS) return true;
+  rpiKnown = false;
+  return false;
+}
+
+// Every datagram goes out through here so profiling builds can time endPacket()
+static void sendPacket() {
+  PROF_SCOPE(PROF_TX);
+  udp.endPacket();
+}
+
+// Unicast to the discovered RPi so slaves never see master traffic;
+// broadcast only until the RPi has been heard from
+static void sendToRpi(const uint8_t* buf, size_t len) {
+  if (rpiReachable()) {
+    udp.beginPacket(rpiAddress, RPI_PORT);
+    rpiUnicasts++;
+  } else {
+    udp.beginPacket(BROADCAST_IP, RPI_PORT);
+    rpiBroadcasts++;
+  }
+  udp.write(buf, len);
+  sendPacket();
+}
+
+static void beginSwarmPacket() {
+#if SWARM_TRANSPORT == SWARM_TRANSPORT_MULTICAST
+  udp.beginPacketMulticast(SWARM_GROUP, UDP_PORT, WiFi.localIP(), MCAST_TTL);
+#else
+  udp.beginPacket(BROADCAST_IP, UDP_PORT);
+#endif
+}
+
+static void beginSwarmSocket() {
+#if SWARM_TRANSPORT == SWARM_TRANSPORT_MULTICAST
+  // Still bound to INADDR_ANY, so RPi beacons and resets keep arriving
+  udp.beginMulticast(WiFi.localIP(), SWARM_GROUP, UDP_PORT);
+#else
+  udp.begin(UDP_PORT);
+#endif
+}
+
+// ESP -> requester: +++Stats,<id>,<rx>,<lost>,<dup>,<reorder>,<jitter_ms>***
+static void sendChannelStats(const IPAddress& to, uint16_t port) {
+  char msg[128];
+  int n = snprintf(msg, sizeof(msg), "%sStats,%d,%lu,%lu,%lu,%lu,%lu%s",
+                   RPI_START,
+                   swarmID,
+                   (unsigned long)rxPackets,
+                   (unsigned long)nodes.seqLost,
+                   (unsigned long)nodes.seqDuplicates,
+                   (unsigned long)nodes.seqReordered,
+                   (unsigned long)nodeTableMeanJitterMs(nodes),
+                   RPI_END);
+  if (n <= 0 || (size_t)n >= sizeof(msg)) return;
+  udp.beginPacket(to, port);
+  udp.write((const uint8_t*)msg, (size_t)n);
+  sendPacket();
+}
+
+// ESP -> requester, or the RPi every METRICS_MS: +++Metrics,<id>,<master>,<uptime_ms>,<loops>,<rx>,<tx>,<rx_drop>,<rx_lost>,
+//   <heap>,<heap_max_block>,<heap_frag_pct>,<rssi>,<role_changes>,<failovers>,<failover_ms>,
+//   <rx_gap_us>,<sched_overruns>,<boot_id>***
+// Counters run from boot and wrap at 32 bits, so the collector derives rates
+// from two scrapes. boot_id changes on every boot.
+// rx_gap_us is the net task's worst gap in the current scheduler window.
+static size_t formatMetrics(char* msg, size_t len) {
+  int n = snprintf(msg, len, "%sMetrics,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%u,%u,%d,%lu,%lu,%lu,%lu,%lu,%lu%s",
+                   RPI_START,
+                   swarmID,
+                   isMaster ? 1 : 0,
+                   (unsigned long)nowMs(),
+                   (unsigned long)sched.passes,
+                   (unsigned long)rxPackets,
+                   (unsigned long)txSent,
+                   (unsigned long)rxDropped,
+                   (unsigned long)nodes.seqLost,
+                   (unsigned long)ESP.getFreeHeap(),
+                   (unsigned)ESP.getMaxFreeBlockSize(),
+                   (unsigned)ESP.getHeapFragmentation(),
+                   linkUp ? (int)WiFi.RSSI() : 0,
+                   (unsigned long)election.roleChanges,
+                   (unsigned long)failovers,
+                   (unsigned long)lastFailoverMs,
+                   (unsigned long)sched.task[0].worstGapUs,
+                   (unsigned long)sched.passOverruns,
+                   (unsigned long)bootId,
+                   RPI_END);
+  return n > 0 && (size_t)n < len ? (size_t)n : 0;
+}
+
+static void sendMetrics(const IPAddress& to, uint16_t port) {
+  char msg[224];
+  size_t n = formatMetrics(msg, sizeof(msg));
+  if (n == 0) return;
+  udp.beginPacket(to, port);
+  udp.write((const uint8_t*)msg, n);
+  sendPacket();
+}
+
+static void sendMetricsIfDue() {
+  if (METRICS_MS == 0 || !linkUp) return;
+  uint32_t t = nowMs();
+  if (t - lastMetricsMs < METRICS_MS) return;
+  lastMetricsMs = t;
+  char msg[224];
+  size_t n = formatMetrics(msg, sizeof(msg));
+  if (n > 0) sendToRpi((const uint8_t*)msg, n);
+}
+
+static void sampleHistoryIfDue() {
+  if (HISTORY_SAMPLE_MS == 0) return;
+  uint32_t t = swarmNowMs();
+  // Swarm time stepped back: restart the cadence instead of waiting it out
+  if ((int32_t)(historyNextMs - t) > (int32_t)(2 * HISTORY_SAMPLE_MS)) {
+    historyNextMs = t - t % HISTORY_SAMPLE_MS;
+  }
+  if ((int32_t)(t - historyNextMs) < 0) return;
+  // After a stall, restart the cadence rather than back-filling; the
+  // ring starts a new block at the break. Samples stay on multiples of
+  // the period, so synced nodes sample at the same instants.
+  if (t - historyNextMs >= HISTORY_SAMPLE_MS) historyNextMs = t - t % HISTORY_SAMPLE_MS;
+#if SWARM_HISTORY_FS
+  historyFsReserveFor(history.nextSeq);
+#endif
+  historyAppend(history, (uint16_t)filteredValue, historyNextMs);
+  historyNextMs += HISTORY_SAMPLE_MS;
+}
+
+// RAM first, then blocks spilled to flash; same contract as historyFind()
+static bool historyBlockFor(uint32_t seq, HistoryBlock& out) {
+  const HistoryBlock* b = historyFind(history, seq);
+#if SWARM_HISTORY_FS
+  if ((b == nullptr || seq < b->firstSeq) && historyFsFind(seq, out) &&
+      (b == nullptr || out.firstSeq < b->firstSeq)) {
+    return true;
+  }
+#endif
+  if (b == nullptr) return false;
+  out = *b;
+  return true;
+}
+
+static void sendHistoryEnd(const IPAddress& to, uint16_t port, uint32_t nextSeq) {
+  char msg[48];
+  int n = snprintf(msg, sizeof(msg), "%sHistoryEnd,%d,%lu%s",
+                   RPI_START, swarmID, (unsigned long)nextSeq, RPI_END);
+  if (n <= 0 || (size_t)n >= sizeof(msg)) return;
+  udp.beginPacket(to, port);
+  udp.write((const uint8_t*)msg, (size_t)n);
+  sendPacket();
+}
+
+// ESP -> requester: +++History,<id>,<seq>,<t_ms>,<period_ms>,<value>,<delta>,<delta>...***
+// Each datagram covers back-to-back samples only and is self-contained:
+// sample i sits at t_ms + i * period_ms, each delta is from the sample
+// before. At most HISTORY_BURST of them go out per request, then
+// +++HistoryEnd,<id>,<next_seq>*** says where to resume. A from_seq older
+// than what we still hold starts at the oldest sample we have.
+static void sendHistory(const IPAddress& to, uint16_t port, uint32_t fromSeq) {
+  if (fromSeq > history.nextSeq) fromSeq = 0;  // we restarted since the last request
+  static uint16_t values[HISTORY_BLOCK_MAX_SAMPLES];
+  const size_t endLen = strlen(RPI_END);
+  const size_t room = sizeof(snapshotBuf) - endLen;
+
+  uint32_t seq = fromSeq;
+  HistoryBlock b;
+  bool have = historyBlockFor(seq, b);
+  for (int d = 0; d < HISTORY_BURST && have; d++) {
+    if (seq < b.firstSeq) seq = b.firstSeq;
+    size_t len = 0;
+    int prev = -1;
+    for (;;) {
+      uint8_t n = historyDecode(b, values);
+      uint8_t k = (uint8_t)(seq - b.firstSeq);
+      for (; k < n; k++) {
+        int w = prev < 0
+            ? snprintf(snapshotBuf, room, "%sHistory,%d,%lu,%lu,%lu,%u",
+                       RPI_START, swarmID,
+                       (unsigned long)seq,
+                       (unsigned long)(b.firstMs + k * HISTORY_SAMPLE_MS),
+                       (unsigned long)HISTORY_SAMPLE_MS,
+                       (unsigned)values[k])
+            : snprintf(snapshotBuf + len, room - len, ",%d", (int)values[k] - prev);
+        if (w < 0 || len + (size_t)w >= room) break;
+        len += (size_t)w;
+        prev = values[k];
+        seq++;
+      }
+      if (k < n) break;  // datagram full; the next one resumes inside b
+
+      HistoryBlock next;
+      have = historyBlockFor(seq, next);
+      if (!have) break;
+      bool joined = historyContiguous(b, next, HISTORY_SAMPLE_MS);
+      b = next;
+      if (!joined) break;
+    }
+    if (len == 0) break;
+
+    memcpy(snapshotBuf + len, RPI_END, endLen);
+    udp.beginPacket(to, port);
+    udp.write((const uint8_t*)snapshotBuf, len + endLen);
+    sendPacket();
+  }
+  sendHistoryEnd(to, port, seq);
+  historyReplies++;
+}
+
+// HISTORY_REQUESTED,<id>,<from_seq>; requests for other IDs are ignored
+static void handleHistoryRequest(const IPAddress& from, uint16_t port, const char* cmd, size_t n) {
+  static const char prefix[] = "HISTORY_REQUESTED,";
+  const size_t prefixLen = sizeof(prefix) - 1;
+  if (n <= prefixLen || memcmp(cmd, prefix, prefixLen) != 0) return;
+
+  const char* p = cmd + prefixLen;
+  const char* end = cmd + n;
+  int id, fromSeq;
+  if (!parseIntField(&p, end, &id) || p >= end || *p++ != ',') return;
+  if (!parseIntField(&p, end, &fromSeq) || p != end || fromSeq < 0) return;
+  if (id != swarmID) return;
+  sendHistory(from, port, (uint32_t)fromSeq);
+}
+
+// Pushes the current parameters into the modules that hold their own copy
+static void applyParams() {
+  nodes.ttlMs = params.peerTtlMs;
+  election.hysteresis = params.hysteresis;
+  election.minHoldMs = params.roleMinHoldMs;
+  intervalLut = makeIntervalTable(params.blinkX1, params.blinkY1, params.blinkX2, params.blinkY2,
+                                  params.blinkMinMs, params.blinkMaxMs);
+  indicatorValue = -1;  // re-arm the blink ticker on the next reading
+  txRedrawHoldoff();
+}
+
+static void printParamSet(const char* name, size_t nameLen, int value, ParamResult r) {
+  LOG_EVENT("[%lu] EVENT param  id=%d  %.*s=%d  result=%s\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            (int)nameLen, name,
+            value,
+            paramResultName(r));
 }
 
-static bool startsWithEndsWith(const String& s, const char* start, const char* end) {
-  return s.startsWith(start) && s.endsWith(end);
+static void markParamsChanged() {
+  paramsDirty = true;
+  paramsChangedMs = nowMs();
+  paramSets++;
+  applyParams();
 }
 
+// Batched so a burst of SET_PARAMs costs one sector erase
+static void saveParamsIfDue() {
+  if (!paramsDirty || nowMs() - paramsChangedMs < PARAMS_SAVE_MS) return;
+  paramsDirty = false;
+  bool written = paramsStore(params);
+  LOG_EVENT("[%lu] EVENT params_saved  id=%d  written=%d\n",
+            (unsigned long)nowMs(), swarmID, written ? 1 : 0);
+}
+
+// ESP -> requester: +++ParamAck,<id>,<name>,<value>,<ok|unknown|range>***
+// value is the one in effect afterwards (the rejected one for unknown names)
+static void sendParamAck(const IPAddress& to, uint16_t port, const char* name, size_t nameLen,
+                         int value, ParamResult r) {
+  char msg[96];
+  int n = snprintf(msg, sizeof(msg), "%sParamAck,%d,%.*s,%d,%s%s",
+                   RPI_START, swarmID, (int)nameLen, name, value, paramResultName(r), RPI_END);
+  if (n <= 0 || (size_t)n >= sizeof(msg)) return;
+  udp.beginPacket(to, port);
+  udp.write((const uint8_t*)msg, (size_t)n);
+  sendPacket();
+}
+
+// ESP -> requester: +++Params,<id>,<name>=<value>,...***
+static void sendParams(const IPAddress& to, uint16_t port) {
+  const size_t endLen = strlen(RPI_END);
+  const size_t room = sizeof(snapshotBuf) - endLen;
+  int w = snprintf(snapshotBuf, room, "%sParams,%d", RPI_START, swarmID);
+  if (w <= 0 || (size_t)w >= room) return;
+  size_t len = (size_t)w;
+  for (uint8_t i = 0; i < paramCount(); i++) {
+    w = snprintf(snapshotBuf + len, room - len, ",%s=%ld", paramName(i), (long)paramGet(params, i));
+    if (w < 0 || len + (size_t)w >= room) break;
+    len += (size_t)w;
+  }
+  memcpy(snapshotBuf + len, RPI_END, endLen);
+  udp.beginPacket(to, port);
+  udp.write((const uint8_t*)snapshotBuf, len + endLen);
+  sendPacket();
+}
+
+// Consumes "<id>" or "*" and reports whether the command is for us
+static bool parseParamTarget(const char** p, const char* end, bool* forUs) {
+  if (*p < end && **p == '*') {
+    (*p)++;
+    *forUs = true;
+    return true;
+  }
+  int id;
+  if (!parseIntField(p, end, &id)) return false;
+  *forUs = id == swarmID;
+  return true;
+}
+
+// SET_PARAM,<id|*>,<name>,<value>   GET_PARAMS,<id|*>   DEFAULT_PARAMS,<id|*>
+// Every addressed node answers the sender. Returns false for other commands.
+static bool handleParamCommand(const IPAddress& from, uint16_t port, const char* cmd, size_t n) {
+  static const char setPrefix[] = "SET_PARAM,";
+  static const char getPrefix[] = "GET_PARAMS,";
+  static const char defPrefix[] = "DEFAULT_PARAMS,";
+  const char* end = cmd + n;
+  const char* p;
+  bool forUs;
+
+  if (n > sizeof(setPrefix) - 1 && memcmp(cmd, setPrefix, sizeof(setPrefix) - 1) == 0) {
+    p = cmd + sizeof(setPrefix) - 1;
+    if (!parseParamTarget(&p, end, &forUs) || p >= end || *p++ != ',') return true;
+    const char* name = p;
+    while (p < end && *p != ',') p++;
+    size_t nameLen = (size_t)(p - name);
+    int value;
+    if (p >= end || *p++ != ',' || !parseIntField(&p, end, &value) || p != end) return true;
+    if (!forUs) return true;
+
+    int idx = paramFind(name, nameLen);
+    ParamResult r = idx < 0 ? PARAM_UNKNOWN : paramSet(params, (uint8_t)idx, value);
+    if (r == PARAM_OK) markParamsChanged();
+    int now = idx < 0 ? value : (int)paramGet(params, (uint8_t)idx);
+    printParamSet(name, nameLen, value, r);
+    sendParamAck(from, port, name, nameLen, now, r);
+    return true;
+  }
+
+  bool get = n > sizeof(getPrefix) - 1 && memcmp(cmd, getPrefix, sizeof(getPrefix) - 1) == 0;
+  bool def = n > sizeof(defPrefix) - 1 && memcmp(cmd, defPrefix, sizeof(defPrefix) - 1) == 0;
+  if (!get && !def) return false;
+  p = cmd + (get ? sizeof(getPrefix) : sizeof(defPrefix)) - 1;
+  if (!parseParamTarget(&p, end, &forUs) || p != end || !forUs) return true;
+  if (def) {
+    paramsDefaults(params);
+    markParamsChanged();
+  }
+  sendParams(from, port);
+  return true;
+}
+
+#if SWARM_OTA
+// ESP -> requester: +++OtaAck,<id>,<status>,<running_version>***
+static void sendOtaAck(const IPAddress& to, uint16_t port, const char* status) {
+  char msg[64];
+  int n = snprintf(msg, sizeof(msg), "%sOtaAck,%d,%s,%s%s",
+                   RPI_START, swarmID, status, SWARM_FW_VERSION, RPI_END);
+  if (n <= 0 || (size_t)n >= sizeof(msg)) return;
+  udp.beginPacket(to, port);
+  udp.write((const uint8_t*)msg, (size_t)n);
+  sendPacket();
+}
+
+static void printOtaFailed(const char* stage) {
+  LOG_EVENT("[%lu] EVENT ota_failed  id=%d  stage=%s  error=%u  written=%lu/%lu\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            stage,
+            (unsigned)otaError,
+            (unsigned long)otaWritten,
+            (unsigned long)otaTotal);
+}
+
+// Peers store a zero reading without the MASTER flag and re-elect at once,
+// instead of waiting out the TTL on our silence
+static void otaStepDown() {
+  otaLeaving = true;
+  otaHandoverLocalMs = nowMs();
+  otaHandoverSwarmMs = swarmNowMs();
+
+  SwarmFrame f;
+  f.type        = SWARM_TYPE_READING;
+  f.flags       = 0;
+  f.nodeId      = (uint16_t)swarmID;
+  f.reading     = 0;
+  f.seq         = ++txSeq;
+  f.timestampMs = otaHandoverSwarmMs;
+  uint8_t frame[SWARM_FRAME_LEN];
+  size_t n = encodeSwarmFrame(frame, f);
+  beginSwarmPacket();
+  udp.write(frame, n);
+  sendPacket();
+
+  isMaster = false;
+  setMasterLed(false);
+}
+
+// Connect, download slice, then verify, step down and restart
+static void serviceOta() {
+  if (otaLeaving) {
+    uint32_t held = nowMs() - otaHandoverLocalMs;
+    if (held < OTA_HANDOVER_MS) return;
+    otaRecordSave(otaHandoverSwarmMs, held, otaVersion);
+    logDrain();
+    Serial.flush();
+    ESP.restart();
+    return;
+  }
+
+  OtaState before = otaState;
+  OtaState s = otaPoll((uint8_t*)snapshotBuf, OTA_CHUNK_BYTES, nowMs());
+  if (before == OTA_REQUESTING && s == OTA_DOWNLOADING) {
+    LOG_EVENT("[%lu] EVENT ota_start  id=%d  from=%s  to=%s  size=%lu\n",
+              (unsigned long)nowMs(),
+              swarmID,
+              SWARM_FW_VERSION,
+              otaVersion,
+              (unsigned long)otaTotal);
+    sendOtaAck(otaRequester, otaRequesterPort, otaStartName(OTA_STARTED));
+  } else if (s == OTA_READY) {
+    LOG_EVENT("[%lu] EVENT ota_verified  id=%d  version=%s  size=%lu  download=%lums\n",
+              (unsigned long)nowMs(),
+              swarmID,
+              otaVersion,
+              (unsigned long)otaTotal,
+              (unsigned long)(nowMs() - otaStartMs));
+    sendOtaAck(otaRequester, otaRequesterPort, "verified");
+    otaStepDown();
+  } else if (s == OTA_FAILED && otaResult != OTA_STARTED) {
+    printOtaFailed(otaStartName(otaResult));
+    sendOtaAck(otaRequester, otaRequesterPort, otaStartName(otaResult));
+    otaState = OTA_IDLE;
+  } else if (s == OTA_FAILED) {
+    printOtaFailed("download");
+    sendOtaAck(otaRequester, otaRequesterPort, otaError == UPDATE_ERROR_MD5 ? "badmd5" : "failed");
+    otaState = OTA_IDLE;
+  }
+}
+
+// Downtime runs from the step-down to our first broadcast on the new image.
+// In swarm time once resynced; otherwise local time, which misses the
+// bootloader's copy of the image.
+static void reportOtaIfDue() {
+  if (!otaReportPending || !firstBroadcastLogged) return;
+  bool synced = SWARM_SYNC && clockSyncSource(swarmClock, nowMs()) != SYNC_NONE;
+  if (SWARM_SYNC && !synced && nowMs() - firstBroadcastMs < SYNC_TTL_MS) return;
+  otaReportPending = false;
+
+  uint32_t downtime = synced ? clockSyncNow(swarmClock, firstBroadcastMs) - otaBoot.handoverSwarmMs
+                             : otaBoot.handoverLocalMs + firstBroadcastMs;
+  const char* clock = synced ? "swarm" : "local";
+  LOG_EVENT("[%lu] EVENT ota_done  id=%d  version=%s  downtime=%lums  clock=%s\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            SWARM_FW_VERSION,
+            (unsigned long)downtime,
+            clock);
+
+  char msg[80];
+  int n = snprintf(msg, sizeof(msg), "%sOtaDone,%d,%s,%lu,%s%s",
+                   RPI_START, swarmID, SWARM_FW_VERSION, (unsigned long)downtime, clock, RPI_END);
+  if (n > 0 && (size_t)n < sizeof(msg)) sendToRpi((const uint8_t*)msg, (size_t)n);
+}
+
+// The whole command has to fit rxBuf, so the URL gets what the other fields
+// leave at their widest: a 5-digit id, the longest version, md5 and token
+static const size_t OTA_CMD_OVERHEAD = (sizeof(RPI_START) - 1) + (sizeof("OTA_UPDATE,") - 1) + 5 + 1 +
+                                       (sizeof(otaVersion) - 1) + 1 + 32 + 1 + 1 + 32 + (sizeof(RPI_END) - 1);
+static const size_t OTA_URL_MAX = RX_BUF_LEN - OTA_CMD_OVERHEAD;
+static_assert(OTA_URL_MAX < sizeof(otaUrl), "otaUrl must hold the longest URL a command can carry");
+
+// OTA_UPDATE,<id>,<version>,<md5>,<url>,<token>; one node per command, so
+// the requester decides the rollout order. The token is otaAuthToken() over
+// "<id>,<version>,<md5>,<url>". This only queues the image; serviceOta()
+// connects and downloads without holding up the loop.
+static bool handleOtaCommand(const IPAddress& from, uint16_t port, const char* cmd, size_t n) {
+  static const char prefix[] = "OTA_UPDATE,";
+  const size_t prefixLen = sizeof(prefix) - 1;
+  if (n <= prefixLen || memcmp(cmd, prefix, prefixLen) != 0) return false;
+  if (!rpiKnown || (uint32_t)from != (uint32_t)rpiAddress) {
+    LOG_EVENT("[%lu] EVENT ota_denied  id=%d  from=%s  reason=sender\n",
+              (unsigned long)nowMs(), swarmID, from.toString().c_str());
+    return true;
+  }
+
+  const char* p = cmd + prefixLen;
+  const char* end = cmd + n;
+  int id;
+  if (!parseIntField(&p, end, &id) || p >= end || *p++ != ',') return true;
+  if (id != swarmID) return true;
+
+  // The token covers everything between the prefix and itself
+  if (end - p < 34 || end[-33] != ',') return true;
+  const char* token = end - 32;
+  const char* signedPart = cmd + prefixLen;
+  end -= 33;
+  if (!otaAuthValid(signedPart, (size_t)(end - signedPart), token)) {
+    LOG_EVENT("[%lu] EVENT ota_denied  id=%d  from=%s  reason=token\n",
+              (unsigned long)nowMs(), swarmID, from.toString().c_str());
+    sendOtaAck(from, port, "denied");
+    return true;
+  }
+
+  const char* version = p;
+  while (p < end && *p != ',') p++;
+  size_t versionLen = (size_t)(p - version);
+  if (p >= end || versionLen == 0 || versionLen >= sizeof(otaVersion)) return true;
+  const char* md5 = ++p;
+  if (end - md5 < 33 || md5[32] != ',') return true;
+  const char* url = md5 + 33;
+  size_t urlLen = (size_t)(end - url);
+  char urlBuf[sizeof(otaUrl)];
+  if (urlLen < 8 || urlLen > OTA_URL_MAX) {
+    sendOtaAck(from, port, "badurl");
+    return true;
+  }
+
+  if (versionLen == strlen(SWARM_FW_VERSION) && memcmp(version, SWARM_FW_VERSION, versionLen) == 0) {
+    sendOtaAck(from, port, "current");
+    return true;
+  }
+  if (otaInProgress()) {
+    sendOtaAck(from, port, "busy");
+    return true;
+  }
+
+  char md5Buf[33];
+  memcpy(md5Buf, md5, 32);
+  md5Buf[32] = '\0';
+  memcpy(urlBuf, url, urlLen);
+  urlBuf[urlLen] = '\0';
+  if (!otaQueue(urlBuf, md5Buf, nowMs())) {
+    sendOtaAck(from, port, "badurl");
+    return true;
+  }
+  memcpy(otaVersion, version, versionLen);
+  otaVersion[versionLen] = '\0';
+  otaRequester = from;
+  otaRequesterPort = port;
+  sendOtaAck(from, port, "queued");
+  return true;
+}
+#endif
+
+// RPI_TIME,<ms>: the RPi's clock, sent right after each beacon
+static void handleTimeBeacon(uint32_t srcIp, const char* cmd, size_t n) {
+  static const char prefix[] = "RPI_TIME,";
+  const size_t prefixLen = sizeof(prefix) - 1;
+  uint32_t ms = 0;
+  size_t i = prefixLen;
+  for (; i < n && cmd[i] >= '0' && cmd[i] <= '9' && i < prefixLen + 10; i++) {
+    ms = ms * 10 + (uint32_t)(cmd[i] - '0');
+  }
+  if (i == prefixLen || i != n) return;
+  noteRpiAddress(srcIp);
+#if SWARM_SYNC
+  noteSwarmTime(SYNC_RPI, ms);
+#else
+  (void)ms;
+#endif
+}
+
+// RPi -> ESP: +++<command>***
+// Master reports share the +++ namespace and also reach us while they are
+// broadcast, so only real RPi commands update the RPi address.
+static bool handleRpiCommand(uint32_t srcIp, const char* buf, size_t len) {
+  size_t n = 0;
+  const char* cmd = framePayload(buf, len, RPI_START, RPI_END, &n);
+  if (!cmd) return false;
+
+  if (payloadEquals(cmd, n, "RPI_BEACON")) {
+    noteRpiAddress(srcIp);
+  } else if (n > 9 && memcmp(cmd, "RPI_TIME,", 9) == 0) {
+    handleTimeBeacon(srcIp, cmd, n);
+  } else if (payloadEquals(cmd, n, "STATS_REQUESTED")) {
+    sendChannelStats(IPAddress(srcIp), udp.remotePort());
+  } else if (payloadEquals(cmd, n, "METRICS_REQUESTED")) {
+    sendMetrics(IPAddress(srcIp), udp.remotePort());
+  } else if (payloadEquals(cmd, n, "PROFILE_REQUESTED")) {
+    PROF_REQUEST_DUMP();
+  } else if (payloadEquals(cmd, n, "RESET_REQUESTED")) {
+    noteRpiAddress(srcIp);
+    handleResetRequest();
+  } else {
+    IPAddress from(srcIp);
+    uint16_t port = udp.remotePort();
+    bool handled = handleParamCommand(from, port, cmd, n);
+#if SWARM_OTA
+    handled = handled || handleOtaCommand(from, port, cmd, n);
+#endif
+    if (!handled) handleHistoryRequest(from, port, cmd, n);
+  }
+  return true;
+}
+
+// Dispatches one datagram straight from rxBuf; nothing is copied or allocated.
+// swarmChannel is false for swarm frames that did not arrive on our group.
+// Returns false if the datagram was not a frame we understand.
+static bool handlePacket(uint32_t srcIp, bool swarmChannel, const uint8_t* buf, int len) {
+  if (len <= 0) return false;
+
+  // Another swarm's traffic (or a broadcast-mode node): ignore, not a drop
+  if (!swarmChannel && (isSwarmFrame(buf, len) || buf[0] == (uint8_t)ESP_START[0])) {
+    rxForeign++;
+    return true;
+  }
+
+  // ESP -> ESP (binary)
+  if (isSwarmFrame(buf, len)) {
+    SwarmFrame frame;
+    if (!decodeSwarmFrame(buf, len, &frame) || frame.type != SWARM_TYPE_READING) return false;
+    storeReading(srcIp, frame, false);
+    return true;
+  }
+
+  const char* text = (const char*)buf;
+  if (handleAsciiReading(srcIp, text, (size_t)len)) return true;
+  return handleRpiCommand(srcIp, text, (size_t)len);
+}
+
+// RPi commands are named in upper case (OTA_UPDATE, SET_PARAM); reports to
+// the RPi are not (Swarm, History)
+static bool isRpiCommandName(const char* p, size_t n) {
+  size_t i = 0;
+  while (i < n && ((p[i] >= 'A' && p[i] <= 'Z') || p[i] == '_')) i++;
+  return i >= 2 && (i == n || p[i] == ',' || p[i] == '*');
+}
+
+// Drains every queued datagram, up to RX_BUDGET_PER_LOOP, so peer readings are
+// current before the election step instead of lagging one packet per pass
+static void drainPackets() {
+  int drained = 0;
+  while (drained < RX_BUDGET_PER_LOOP) {
+    int packetSize = udp.parsePacket();
+    if (packetSize <= 0) break;
+    drained++;
+    rxPackets++;
+
+    int len = udp.read(rxBuf, sizeof(rxBuf));
+
+    // Large RPi-bound reports (snapshots, history) are not for us; anything
+    // else that does not fit is a drop, and a lost RPi command is logged
+    if (packetSize > (int)sizeof(rxBuf)) {
+      size_t n = strlen(RPI_START);
+      bool framed = len >= (int)n && memcmp(rxBuf, RPI_START, n) == 0;
+      bool command = framed && isRpiCommandName((const char*)rxBuf + n, (size_t)len - n);
+      if (command) {
+        LOG_EVENT("[%lu] EVENT rx_oversized  id=%d  from=%s  len=%d\n",
+                  (unsigned long)nowMs(), swarmID, udp.remoteIP().toString().c_str(), packetSize);
+      }
+      if (!framed || command) rxDropped++;
+      continue;
+    }
+
+#if SWARM_TRANSPORT == SWARM_TRANSPORT_MULTICAST
+    bool swarmChannel = (uint32_t)udp.destinationIP() == (uint32_t)SWARM_GROUP;
+#else
+    bool swarmChannel = true;
+#endif
+    PROF_SCOPE(PROF_PARSE);
+    if (!handlePacket((uint32_t)udp.remoteIP(), swarmChannel, rxBuf, len)) rxDropped++;
+  }
+
+  if (drained == RX_BUDGET_PER_LOOP) rxBudgetHits++;
+  if (drained > rxQueuePeak) rxQueuePeak = drained;
+}
+
+static void printWifiLost(uint8_t reason) {
+  LOG_EVENT("[%lu] EVENT wifi_lost  id=%d  reason=%u\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            (unsigned)reason);
+}
+
+static void printWifiRestored(const IPAddress& ip, uint32_t outageMs) {
+  LOG_EVENT("[%lu] EVENT wifi_restored  id=%d  ip=%d.%d.%d.%d  outage=%lums\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            ip[0], ip[1], ip[2], ip[3],
+            (unsigned long)outageMs);
+}
+
+static void onWifiGotIp(const WiFiEventStationModeGotIP&) {
+  wifiUpEvent = true;
+}
+
+static void onWifiDisconnected(const WiFiEventStationModeDisconnected& e) {
+  wifiDropReason = (uint8_t)e.reason;
+  wifiDropEvent = true;
+}
+
+// Link recovery, driven by the WiFi events. While down, transmit pauses but
+// sampling, LEDs and the reset state machine carry on. On the way back up
+// the socket is re-opened (multicast membership does not survive the
+// interface going down) and the outage is logged.
+static void updateLink() {
+  uint32_t t = nowMs();
+  if (wifiDropEvent) {
+    wifiDropEvent = false;
+    if (linkUp) {
+      linkUp = false;
+      linkDownSinceMs = t;
+      linkLastRetryMs = t;
+      linkOutages++;
+      printWifiLost(wifiDropReason);
+    }
+  }
+
+  if (wifiUpEvent) {
+    wifiUpEvent = false;
+    if (!linkUp && WiFi.status() == WL_CONNECTED) {
+      IPAddress ip = WiFi.localIP();
+      localIpKey = (uint32_t)ip;
+      legacyId = legacyAsciiId(ip[3]);
+      txAssignSlot(ip);
+      beginSwarmSocket();
+
+      linkUp = true;
+      linkLastOutageMs = t - linkDownSinceMs;
+      lastReceivedTime = t;
+      txRedrawHoldoff();
+      printWifiRestored(ip, linkLastOutageMs);
+#if SWARM_FAST_CONNECT
+      // Only touches flash if the AP, channel or lease changed
+      WifiCache cache;
+      wifiCacheCapture(cache, ssid);
+      wifiCacheStore(cache);
+#endif
+    }
+  }
+
+  // Non-blocking; the SDK scans in the background
+  if (!linkUp && t - linkLastRetryMs >= WIFI_RETRY_MS) {
+    linkLastRetryMs = t;
+    WiFi.begin(ssid, password);
+  }
+}
+
+// Polls for a connection; timeoutMs = 0 waits forever
+static bool waitForWifi(uint32_t timeoutMs) {
+  uint32_t start = nowMs();
+  uint32_t lastDot = start;
+  while (WiFi.status() != WL_CONNECTED) {
+    if (timeoutMs != 0 && nowMs() - start >= timeoutMs) return false;
+    if (nowMs() - lastDot >= 500) {
+      lastDot = nowMs();
+      Serial.print(".");
+    }
+    delay(10);
+  }
+  return true;
+}
+
+// Cached BSSID/channel/lease first, then a full scan plus DHCP
+static void connectWifi() {
+  Serial.print("WiFi connecting");
+#if SWARM_FAST_CONNECT
+  WifiCache cache;
+  WifiCacheSource source = wifiCacheLoad(cache, ssid);
+  if (source != WIFI_CACHE_NONE) {
+#if SWARM_FAST_STATIC_IP
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.mask), IPAddress(cache.dns));
+#endif
+    WiFi.begin(ssid, password, cache.channel, cache.bssid);
+    if (waitForWifi(FAST_CONNECT_TIMEOUT_MS)) {
+      wifiPath = source == WIFI_CACHE_RTC ? "rtc" : "flash";
+    } else {
+      // AP moved, changed channel or is gone: forget it and do it the slow way
+      WiFi.disconnect();
+      WiFi.config(IPAddress(), IPAddress(), IPAddress());
+      source = WIFI_CACHE_NONE;
+    }
+  }
+  if (source == WIFI_CACHE_NONE) {
+    WiFi.begin(ssid, password);
+    waitForWifi(0);
+  }
+  wifiUpMs = nowMs();
+  Serial.println();
+
+  wifiCacheCapture(cache, ssid);
+  if (wifiCacheStore(cache)) Serial.println("WiFi cache updated");
+#else
+  WiFi.begin(ssid, password);
+  waitForWifi(0);
+  wifiUpMs = nowMs();
+  Serial.println();
+#endif
+}
+
+static void registerTasks();
+
 void setup() {
   Serial.begin(115200);
   delay(10);
@@ -123,118 +1550,332 @@ void setup() {
   digitalWrite(LED_INDICATOR, HIGH);
   digitalWrite(LED_MASTER, HIGH);
 
-  for (int i = 0; i < MAX_SWARM; i++) readings[i] = -1;
+  nodeTableInit(nodes, onNodeExpired);
+  clockSyncInit(swarmClock);
+  paramsDefaults(params);
+  paramsFromFlash = paramsLoad(params);
+  applyParams();
+#if SWARM_OTA
+  otaReportPending = otaRecordTake(otaBoot);
+#endif
 
-  computeSlopeIntercept(X1, Y1, X2, Y2, &slope, &intercept);
+#if SWARM_HISTORY_FS
+  historyInit(history, HISTORY_SAMPLE_MS, historyFsAppend);
+  history.nextSeq = historyFsBegin();
+#else
+  historyInit(history, HISTORY_SAMPLE_MS, nullptr);
+#endif
 
-  WiFi.begin(ssid, password);
-  Serial.print("WiFi connecting");
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
-  }
-  Serial.println();
+  chipId = ESP.getChipId();
+  swarmID = SWARM_NODE_ID >= 0 ? SWARM_NODE_ID : (int)(chipId & 0xFFFF);
+
+  // Prime the filter so the first broadcast is a real reading
+  adcSampleTick();
+  adcTicker.attach_ms(ADC_SAMPLE_MS, adcSampleTick);
+
+#if SWARM_POWER_MODE == SWARM_POWER_LIGHT
+  WiFi.setSleepMode(WIFI_LIGHT_SLEEP, POWER_LISTEN_INTERVAL);
+#elif SWARM_POWER_MODE == SWARM_POWER_MODEM
+  WiFi.setSleepMode(WIFI_MODEM_SLEEP, POWER_LISTEN_INTERVAL);
+#endif
+  // The cache below replaces the SDK's own flash copy of the credentials,
+  // which would otherwise be rewritten on every begin()
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  connectWifi();
 
   IPAddress ip = WiFi.localIP();
-  swarmID = ip[3] % 10;
+  localIpKey = (uint32_t)ip;
+  legacyId = legacyAsciiId(ip[3]);
+  txAssignSlot(ip);
 
-  Serial.printf("WiFi OK  ip=%d.%d.%d.%d  id=%d  port=%u\n",
+  Serial.printf("WiFi OK  ip=%d.%d.%d.%d  id=%d  chip=%06lx  fw=%s  port=%u  transport=%s  power=%s  path=%s  params=%s  after=%lums\n",
                 ip[0], ip[1], ip[2], ip[3],
                 swarmID,
-                UDP_PORT);
+                (unsigned long)chipId,
+                SWARM_FW_VERSION,
+                UDP_PORT,
+                SWARM_TRANSPORT == SWARM_TRANSPORT_MULTICAST ? "multicast" : "broadcast",
+                SWARM_POWER_MODE == SWARM_POWER_LIGHT ? "light" :
+                SWARM_POWER_MODE == SWARM_POWER_MODEM ? "modem" : "off",
+                wifiPath,
+                paramsFromFlash ? "flash" : "defaults",
+                (unsigned long)wifiUpMs);
 
-  udp.begin(UDP_PORT);
+  beginSwarmSocket();
+  wifiGotIpHandler = WiFi.onStationModeGotIP(onWifiGotIp);
+  wifiDisconnectedHandler = WiFi.onStationModeDisconnected(onWifiDisconnected);
+
+  randomSeed(ESP.random());
+  bootId = ESP.random();
+  txRedrawHoldoff();
 
   lastReceivedTime = nowMs();
   lastStatusPrint = nowMs();
+  powerLastCycles = ESP.getCycleCount();
+  powerWindowStartUs = micros();
 
   isMaster = true;
   prevIsMaster = true;
+
+  registerTasks();
+  lastSchedReport = nowMs();
 }
 
-void loop() {
-  // Indicator LED always blinks based on last known analogValue
-  flashIndicatorByReading(analogValue);
+// Master -> RPi: +++Swarm,<master_id>,<id>:<value>:<age_ms>;<id>:<value>:<age_ms>...***
+// The master itself is the first entry (age 0). Entries that would push the
+// frame past SNAPSHOT_MAX_BYTES are left out rather than fragmenting.
+static void sendSnapshotIfDue() {
+  if (params.snapshotMs == 0) return;
+  uint32_t t = nowMs();
+  if (t - lastSnapshotMs < params.snapshotMs) return;
+  lastSnapshotMs = t;
 
-  // Master LED steady ON if Master, otherwise OFF
-  digitalWrite(LED_MASTER, isMaster ? LOW : HIGH);
-
-  // ===== Receive packets =====
-  int packetSize = udp.parsePacket();
-  if (packetSize > 0) {
-    char incoming[255];
-    int len = udp.read(incoming, 254);
-    if (len > 0) incoming[len] = '\0';
-
-    String pkt(incoming);
-
-    // ESP -> ESP: ~~~<id>,<reading>---
-    if (startsWithEndsWith(pkt, ESP_START, ESP_END)) {
-      String data = pkt.substring(strlen(ESP_START), pkt.length() - strlen(ESP_END));
-      int rid = -1, rval = -1;
-      if (sscanf(data.c_str(), "%d,%d", &rid, &rval) == 2) {
-        if (rid >= 0 && rid < MAX_SWARM) {
-          readings[rid] = rval;
-          lastReceivedTime = nowMs();
-        }
-      }
-    }
+  const size_t endLen = strlen(RPI_END);
+  const size_t room = sizeof(snapshotBuf) - endLen;
+  int n = snprintf(snapshotBuf, room, "%sSwarm,%d,%d:%d:0",
+                   RPI_START, swarmID, swarmID, advertisedValue);
+  if (n < 0 || (size_t)n >= room) return;
+  size_t len = (size_t)n;
 
-    // RPi reset: +++RESET_REQUESTED***
-    if (startsWithEndsWith(pkt, RPI_START, RPI_END)) {
-      String data = pkt.substring(strlen(RPI_START), pkt.length() - strlen(RPI_END));
-      if (data == "RESET_REQUESTED") {
-        // Turn both LEDs OFF immediately (active LOW)
-        digitalWrite(LED_INDICATOR, HIGH);
-        digitalWrite(LED_MASTER, HIGH);
+  for (uint16_t i = 0; i < NODE_TABLE_SIZE; i++) {
+    if (nodes.key[i] == 0 || nodeExpired(nodes, i, t)) continue;
+    n = snprintf(snapshotBuf + len, room - len, ";%u:%d:%lu",
+                 (unsigned)nodes.nodeId[i],
+                 nodes.reading[i],
+                 (unsigned long)(t - nodes.lastSeenMs[i]));
+    if (n < 0 || len + (size_t)n >= room) break;
+    len += (size_t)n;
+  }
+
+  memcpy(snapshotBuf + len, RPI_END, endLen);
+  len += endLen;
 
-        // Reset state
-        isMaster = true;
-        prevIsMaster = true;
-        for (int i = 0; i < MAX_SWARM; i++) readings[i] = -1;
+  sendToRpi((const uint8_t*)snapshotBuf, len);
+  snapshotsSent++;
+}
 
-        printResetEvent();
-        delay(3000);
+// Time from power-on (millis() starts at reset) to our first frame on air
+static void printFirstBroadcast() {
+  uint32_t t = nowMs();
+  LOG_EVENT("[%lu] EVENT first_broadcast  id=%d  boot_to_tx=%lums  wifi=%lums  path=%s\n",
+            (unsigned long)t,
+            swarmID,
+            (unsigned long)t,
+            (unsigned long)wifiUpMs,
+            wifiPath);
+}
 
-        lastReceivedTime = nowMs();
+static void printReconverged(uint32_t afterMs) {
+  LOG_EVENT("[%lu] EVENT reconverged  id=%d  role=%s  after=%lums\n",
+            (unsigned long)nowMs(),
+            swarmID,
+            isMaster ? "MASTER" : "SLAVE",
+            (unsigned long)afterMs);
+}
+
+// Advances the reset state machine; never blocks
+static void updateNodeState() {
+  uint32_t t = nowMs();
+  switch (nodeState) {
+    case NODE_RESET_HOLD:
+      if (t - nodeStateSinceMs < RESET_HOLD_MS) return;
+      rejoinDelayMs = ((uint32_t)swarmID & 0x0F) * REJOIN_STAGGER_MS;
+      enterState(NODE_REJOIN);
+      return;
+
+    case NODE_REJOIN:
+      if (t - nodeStateSinceMs < rejoinDelayMs) return;
+      lastReceivedTime = t;
+      rejoinedAtMs = t;
+      lastRoleChangeMs = t;
+      enterState(NODE_RUNNING);
+      return;
+
+    case NODE_RUNNING:
+      // Converged once roles have been stable for CONVERGE_STABLE_MS; report
+      // the time from rejoining to the last role change
+      if (rejoinedAtMs != 0 && t - lastRoleChangeMs >= CONVERGE_STABLE_MS) {
+        printReconverged(lastRoleChangeMs - rejoinedAtMs);
+        rejoinedAtMs = 0;
       }
-    }
+      return;
   }
+}
 
-  // ===== If silent for 200ms, read sensor and broadcast =====
-  if (nowMs() - lastReceivedTime > SILENT_MS) {
-    analogValue = analogRead(PHOTORESISTOR_PIN);
+// Idles until just before the next transmit turn. delay() yields to the SDK,
+// which is what lets modem/light sleep engage; the wake guard leaves time to
+// drain peer frames the AP delivered meanwhile. Never idles with log output
+// pending, since light sleep would stall the UART mid-line.
+static void powerIdle() {
+#if SWARM_POWER_MODE != SWARM_POWER_OFF
+  // Downloads run at loop() speed
+  if (nodeState != NODE_RUNNING || logUsed() > 0 || otaInProgress()) return;
+  uint32_t ms = linkUp ? txTimeToTurn() : POWER_MAX_IDLE_MS;
+  if (ms <= POWER_WAKE_GUARD_MS) return;
+  ms -= POWER_WAKE_GUARD_MS;
+  if (ms > POWER_MAX_IDLE_MS) ms = POWER_MAX_IDLE_MS;
+  powerIdleMs += ms;
+  delay(ms);
+#endif
+}
 
-    // ESP -> ESP broadcast
-    char espMsg[64];
-    snprintf(espMsg, sizeof(espMsg), "%s%d,%d%s", ESP_START, swarmID, analogValue, ESP_END);
-    udp.beginPacket(BROADCAST_IP, UDP_PORT);
-    udp.write((const uint8_t*)espMsg, strlen(espMsg));
-    udp.endPacket();
+static uint32_t schedClockUs() {
+  return micros();
+}
 
-    lastReceivedTime = nowMs();
+// One TASK line per task; max and gap cover the report window. The net
+// task's gap bounds how long a datagram can wait in the socket.
+static void printSchedIfDue() {
+  if (SCHED_REPORT_MS == 0) return;
+  uint32_t t = nowMs();
+  if (t - lastSchedReport < SCHED_REPORT_MS) return;
+  lastSchedReport = t;
+  PROF_SCOPE(PROF_LOG);
 
-    // Decide Master (highest reading)
-    isMaster = true;
-    for (int i = 0; i < MAX_SWARM; i++) {
-      if (i == swarmID) continue;
-      if (readings[i] >= 0 && readings[i] > analogValue) {
-        isMaster = false;
-        break;
-      }
+  LOG_STATUS("[%lu] SCHED id=%d passes=%lu overruns=%lu max=%luus budget=%luus\n",
+             (unsigned long)t,
+             swarmID,
+             (unsigned long)sched.passes,
+             (unsigned long)sched.passOverruns,
+             (unsigned long)sched.worstPassUs,
+             (unsigned long)sched.passBudgetUs);
+  for (uint8_t i = 0; i < sched.count; i++) {
+    const SchedTask& k = sched.task[i];
+    LOG_STATUS("[%lu] TASK id=%d name=%s prio=%u runs=%lu overruns=%lu deferrals=%lu max=%luus gap=%luus budget=%luus\n",
+               (unsigned long)t,
+               swarmID,
+               k.name,
+               (unsigned)k.priority,
+               (unsigned long)k.runs,
+               (unsigned long)k.overruns,
+               (unsigned long)k.deferrals,
+               (unsigned long)k.worstUs,
+               (unsigned long)k.worstGapUs,
+               (unsigned long)k.budgetUs);
+  }
+  schedResetWindow(sched);
+}
+
+// ===== Receive packets (also during reset, so the socket never backs up) =====
+static void netTask() {
+  updateLink();
+  updateNodeState();
+  drainPackets();
+  nodeTableSweep(nodes, nowMs());
+}
+
+// ===== When our turn comes, read sensor and broadcast =====
+static void turnTask() {
+  if (nodeState != NODE_RUNNING || !linkUp || otaLeaving || !txDue()) return;
+  analogValue = SWARM_SYNC ? epochValue : filteredValue;
+
+  // ESP -> ESP broadcast, skipped while the reading stays inside the deadband
+  if (txNeeded(analogValue)) {
+    txSeq++;
+    if (useLegacyTx()) {
+      // Baseline nodes drop IDs outside 0..9; the wide ID is binary-only
+      char espMsg[32];
+      size_t n = encodeAsciiReading(espMsg, sizeof(espMsg), legacyId, (uint16_t)analogValue);
+      beginSwarmPacket();
+      udp.write((const uint8_t*)espMsg, n);
+      sendPacket();
+    } else {
+      SwarmFrame f;
+      f.type        = SWARM_TYPE_READING;
+      f.flags       = isMaster ? SWARM_FLAG_MASTER : 0;
+      f.nodeId      = (uint16_t)swarmID;
+      f.reading     = (uint16_t)analogValue;
+      f.seq         = txSeq;
+      f.timestampMs = swarmNowMs();
+
+      uint8_t espFrame[SWARM_FRAME_LEN];
+      size_t n = encodeSwarmFrame(espFrame, f);
+      beginSwarmPacket();
+      udp.write(espFrame, n);
+      sendPacket();
     }
 
-    // Master -> RPi broadcast
-    if (isMaster) {
-      char rpiMsg[80];
-      snprintf(rpiMsg, sizeof(rpiMsg), "%sMaster,%d,%d%s", RPI_START, swarmID, analogValue, RPI_END);
-      udp.beginPacket(BROADCAST_IP, UDP_PORT);
-      udp.write((const uint8_t*)rpiMsg, strlen(rpiMsg));
-      udp.endPacket();
+    advertisedValue = analogValue;
+    lastAdvertisedMs = nowMs();
+    txSent++;
+    if (!firstBroadcastLogged) {
+      firstBroadcastLogged = true;
+      firstBroadcastMs = nowMs();
+      printFirstBroadcast();
     }
+  } else {
+    txSuppressed++;
+  }
+
+  lastReceivedTime = nowMs();
+  txOnTurn();
 
-    // ===== Logs (minimal) =====
-    printRoleChangeIfNeeded(isMaster, analogValue);
-    printStatusIfDue(isMaster, analogValue);
+  // Decide Master
+  isMaster = runElection();
+
+  // Master -> RPi report
+  if (isMaster) {
+    char rpiMsg[80];
+    snprintf(rpiMsg, sizeof(rpiMsg), "%sMaster,%d,%d%s", RPI_START, swarmID, analogValue, RPI_END);
+    sendToRpi((const uint8_t*)rpiMsg, strlen(rpiMsg));
   }
+
+  if (isMaster) sendSnapshotIfDue();
+
+  // Logged here rather than in logTask, so the failover latency is exact
+  printRoleChangeIfNeeded(isMaster, analogValue);
+}
+
+static void sampleTask() {
+  sampleHistoryIfDue();
+}
+
+static void backgroundTask() {
+  saveParamsIfDue();
+  sendMetricsIfDue();
+#if SWARM_OTA
+  serviceOta();
+  reportOtaIfDue();
+#endif
+}
+
+static void ledTask() {
+  if (nodeState != NODE_RUNNING) return;
+  // Indicator LED always blinks based on last known analogValue
+  updateIndicator(analogValue);
+  // Master LED steady ON if Master, otherwise OFF
+  setMasterLed(isMaster);
+}
+
+// ===== Logs (minimal) =====
+static void logTask() {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < heapLowWatermark) heapLowWatermark = freeHeap;
+
+  if (nodeState == NODE_RUNNING) printStatusIfDue(isMaster, analogValue);
+  printSchedIfDue();
+  logDrain();
+}
+
+static void registerTasks() {
+  schedInit(sched, SCHED_PASS_BUDGET_US, PRIO_TURN, schedClockUs);
+  schedAdd(sched, "net",        netTask,        PRIO_NET,        0, NET_BUDGET_US);
+  schedAdd(sched, "turn",       turnTask,       PRIO_TURN,       0, TURN_BUDGET_US);
+  schedAdd(sched, "sample",     sampleTask,     PRIO_SAMPLE,     0, SAMPLE_BUDGET_US);
+  schedAdd(sched, "background", backgroundTask, PRIO_BACKGROUND, 0, BACKGROUND_BUDGET_US);
+  schedAdd(sched, "led",        ledTask,        PRIO_LED,        SCHED_LED_MS, LED_BUDGET_US);
+  schedAdd(sched, "log",        logTask,        PRIO_LOG,        0, LOG_BUDGET_US);
+}
+
+void loop() {
+  // Outside the profiled section, so idle time never lands in the loop histogram
+  powerIdle();
+  powerAccount();
+
+  PROF_SERVICE(nowMs());
+  PROF_LOOP_TICK();
+  PROF_SCOPE(PROF_LOOP);
+
+  schedRunPass(sched, nowMs());
 }
@@ -0,0 +1,174 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "swarm_election.h"
+#include "swarm_frame.h"
+
+// Host-side throughput checks for the codec and the election step. Results
+// are printed as BENCH lines; the floors below are deliberately loose so only
+// an algorithmic regression (not CI noise) fails the build. Override them
+// with -D when profiling on a known machine.
+#ifndef BENCH_MIN_FRAMES_PER_SEC
+#define BENCH_MIN_FRAMES_PER_SEC 2000000
+#endif
+#ifndef BENCH_MIN_ASCII_PER_SEC
+#define BENCH_MIN_ASCII_PER_SEC 2000000
+#endif
+#ifndef BENCH_MAX_ELECT_NS
+#define BENCH_MAX_ELECT_NS 2000
+#endif
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 2000000
+#endif
+
+static const int FRAME_POOL = 256;
+
+static volatile uint32_t sink;
+static NodeTable table;
+static ElectionState election;
+
+void setUp() {}
+void tearDown() {}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint32_t rng = 0x9E3779B9;
+static uint32_t nextRand() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void test_binary_decode_throughput() {
+  static uint8_t pool[FRAME_POOL][SWARM_FRAME_LEN];
+  for (int i = 0; i < FRAME_POOL; i++) {
+    SwarmFrame f = {};
+    f.type        = SWARM_TYPE_READING;
+    f.nodeId      = (uint16_t)i;
+    f.reading     = (uint16_t)(nextRand() % 1025);
+    f.seq         = (uint16_t)nextRand();
+    f.timestampMs = nextRand();
+    encodeSwarmFrame(pool[i], f);
+  }
+
+  uint32_t acc = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    SwarmFrame f;
+    if (decodeSwarmFrame(pool[i & (FRAME_POOL - 1)], SWARM_FRAME_LEN, &f)) acc += f.reading;
+  }
+  double rate = BENCH_ITERATIONS / secondsSince(start);
+  sink = acc;
+
+  printf("BENCH decode_binary frames_per_sec=%.0f ns_per_frame=%.1f\n", rate, 1e9 / rate);
+  TEST_ASSERT_TRUE(rate >= BENCH_MIN_FRAMES_PER_SEC);
+}
+
+static void test_ascii_decode_throughput() {
+  static char pool[FRAME_POOL][24];
+  static size_t lens[FRAME_POOL];
+  for (int i = 0; i < FRAME_POOL; i++) {
+    lens[i] = (size_t)snprintf(pool[i], sizeof(pool[i]), "%s%d,%u%s",
+                               ESP_START, i, (unsigned)(nextRand() % 1025), ESP_END);
+  }
+
+  uint32_t acc = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    SwarmFrame f;
+    int k = i & (FRAME_POOL - 1);
+    if (decodeAsciiReading(pool[k], lens[k], &f) == ASCII_READING) acc += f.reading;
+  }
+  double rate = BENCH_ITERATIONS / secondsSince(start);
+  sink = acc;
+
+  printf("BENCH decode_ascii frames_per_sec=%.0f ns_per_frame=%.1f\n", rate, 1e9 / rate);
+  TEST_ASSERT_TRUE(rate >= BENCH_MIN_ASCII_PER_SEC);
+}
+
+static void fillTable(int peers, uint16_t* seq) {
+  nodeTableInit(table, nullptr);
+  election = ElectionState();
+  for (int p = 0; p < peers; p++) {
+    SwarmFrame f = {};
+    f.type    = SWARM_TYPE_READING;
+    f.nodeId  = (uint16_t)(p + 1);
+    f.reading = (uint16_t)(nextRand() % 1025);
+    f.seq     = ++seq[p];
+    nodeTableStore(table, 0x0100A8C0u + ((uint32_t)(p + 1) << 24), f, false, 0);
+  }
+}
+
+// One received reading plus one election, as loop() does per packet and turn
+static double storeAndElectNs(int peers) {
+  static uint16_t seq[NODE_TABLE_SIZE];
+  memset(seq, 0, sizeof(seq));
+  fillTable(peers, seq);
+
+  ElectionSelf self = {512, 0, 0x0100A8C0};
+  bool master = true;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    int p = i % peers;
+    SwarmFrame f = {};
+    f.type    = SWARM_TYPE_READING;
+    f.nodeId  = (uint16_t)(p + 1);
+    f.reading = (uint16_t)(nextRand() % 1025);
+    f.seq     = ++seq[p];
+    nodeTableStore(table, 0x0100A8C0u + ((uint32_t)(p + 1) << 24), f, false, 0);
+    master = electMaster(table, election, self, master, 0);
+  }
+  sink = master;
+  return secondsSince(start) * 1e9 / BENCH_ITERATIONS;
+}
+
+// Worst case: the leader's own reading keeps falling, forcing a full rescan
+static double rescanNs(int peers) {
+  static uint16_t seq[NODE_TABLE_SIZE];
+  memset(seq, 0, sizeof(seq));
+  fillTable(peers, seq);
+
+  const int rounds = BENCH_ITERATIONS / 10;
+  uint32_t acc = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    int leader = nodeTableLeader(table, 0);
+    SwarmFrame f = {};
+    f.type    = SWARM_TYPE_READING;
+    f.nodeId  = table.nodeId[leader];
+    f.reading = (uint16_t)(nextRand() % 1025);
+    f.seq     = ++seq[f.nodeId - 1];
+    table.reading[leader] = 1024;  // make sure this update is a drop
+    nodeTableStore(table, table.key[leader], f, false, 0);
+    acc += (uint32_t)nodeTableLeader(table, 0);
+  }
+  sink = acc;
+  return secondsSince(start) * 1e9 / rounds;
+}
+
+static void test_election_cost_vs_swarm_size() {
+  const int sizes[] = {1, 4, 8, 16, 32, 48, 60};
+  double worst = 0;
+  for (int peers : sizes) {
+    if (peers >= NODE_TABLE_SIZE) continue;
+    double elect = storeAndElectNs(peers);
+    double rescan = rescanNs(peers);
+    printf("BENCH election peers=%d table=%u store_elect_ns=%.1f leader_rescan_ns=%.1f\n",
+           peers, (unsigned)NODE_TABLE_SIZE, elect, rescan);
+    if (elect > worst) worst = elect;
+  }
+  TEST_ASSERT_TRUE(worst <= BENCH_MAX_ELECT_NS);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_binary_decode_throughput);
+  RUN_TEST(test_ascii_decode_throughput);
+  RUN_TEST(test_election_cost_vs_swarm_size);
+  return UNITY_END();
+}
@@ -0,0 +1,118 @@
+#include <stdint.h>
+#include <unity.h>
+
+#include "clock_sync.h"
+
+static ClockSync sync;
+
+void setUp() {
+  clockSyncInit(sync);
+}
+
+void tearDown() {}
+
+static uint32_t rng = 4242;
+static uint32_t nextRand() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+// A reference clock and a local clock running ppm fast, offset by offsetMs
+struct Clocks {
+  double   ppm;
+  uint32_t offsetMs;
+  uint32_t localAt(uint32_t refMs) const {
+    return (uint32_t)(offsetMs + (uint64_t)(refMs * (1.0 + ppm / 1e6)));
+  }
+};
+
+static int32_t absErr(uint32_t refMs, uint32_t estimate) {
+  int32_t e = (int32_t)(estimate - refMs);
+  return e < 0 ? -e : e;
+}
+
+// Beacons every 2 s with 0..jitter ms of delivery delay
+static void feed(const Clocks& k, uint32_t fromMs, uint32_t toMs, uint32_t jitterMs) {
+  for (uint32_t t = fromMs; t < toMs; t += 2000) {
+    uint32_t delay = 2 + (jitterMs ? nextRand() % (jitterMs + 1) : 0);
+    clockSyncSample(sync, SYNC_RPI, t, k.localAt(t + delay));
+  }
+}
+
+static void test_unsynced_is_local_time() {
+  TEST_ASSERT_EQUAL_UINT32(12345, clockSyncNow(sync, 12345));
+  TEST_ASSERT_EQUAL(SYNC_NONE, clockSyncSource(sync, 0));
+}
+
+static void test_first_sample_steps() {
+  TEST_ASSERT_TRUE(clockSyncSample(sync, SYNC_RPI, 1000000, 500));
+  TEST_ASSERT_EQUAL_UINT32(1000100, clockSyncNow(sync, 600));
+  TEST_ASSERT_EQUAL_UINT32(1, sync.steps);
+  TEST_ASSERT_EQUAL(SYNC_RPI, clockSyncSource(sync, 600));
+}
+
+static void test_tracks_drift_and_offset() {
+  Clocks k = {60.0, 0xFFFF0000u};  // also crosses the local 32-bit wrap
+  feed(k, 0, 20 * 60000, 20);
+
+  TEST_ASSERT_EQUAL_UINT32(1, sync.steps);
+  TEST_ASSERT_TRUE(clockSyncDriftPpm(sync) <= -45 && clockSyncDriftPpm(sync) >= -75);
+  uint32_t t = 20 * 60000;
+  TEST_ASSERT_TRUE(absErr(t, clockSyncNow(sync, k.localAt(t))) <= 15);
+
+  // Two minutes without beacons: the drift estimate carries the clock
+  t += 120000;
+  TEST_ASSERT_TRUE(absErr(t, clockSyncNow(sync, k.localAt(t))) <= 20);
+  TEST_ASSERT_EQUAL(SYNC_NONE, clockSyncSource(sync, k.localAt(t)));
+}
+
+// Two nodes with different crystals agree with each other
+static void test_nodes_agree() {
+  Clocks a = {35.0, 1000}, b = {-40.0, 777777};
+  ClockSync sa, sb;
+  clockSyncInit(sa);
+  clockSyncInit(sb);
+  for (uint32_t t = 0; t < 10 * 60000; t += 2000) {
+    clockSyncSample(sa, SYNC_RPI, t, a.localAt(t + 2 + nextRand() % 15));
+    clockSyncSample(sb, SYNC_RPI, t, b.localAt(t + 2 + nextRand() % 15));
+  }
+  uint32_t t = 10 * 60000 + 700;
+  TEST_ASSERT_TRUE(absErr(clockSyncNow(sa, a.localAt(t)), clockSyncNow(sb, b.localAt(t))) <= 20);
+}
+
+static void test_reference_restart_steps() {
+  Clocks k = {0.0, 5000};
+  feed(k, 0, 60000, 0);
+  // RPi restarted: its clock is back near zero
+  clockSyncSample(sync, SYNC_RPI, 10, k.localAt(62000));
+  TEST_ASSERT_EQUAL_UINT32(2, sync.steps);
+  TEST_ASSERT_EQUAL_UINT32(110, clockSyncNow(sync, k.localAt(62100)));
+}
+
+static void test_master_only_while_rpi_silent() {
+  clockSyncSample(sync, SYNC_RPI, 100000, 0);
+  TEST_ASSERT_FALSE(clockSyncSample(sync, SYNC_MASTER, 555, 1000));
+  TEST_ASSERT_EQUAL_UINT32(101000, clockSyncNow(sync, 1000));
+
+  // RPi silent past the TTL: the MASTER takes over (one step)
+  TEST_ASSERT_TRUE(clockSyncSample(sync, SYNC_MASTER, 200000, SYNC_TTL_MS + 5));
+  TEST_ASSERT_EQUAL(SYNC_MASTER, clockSyncSource(sync, SYNC_TTL_MS + 10));
+
+  // and hands back as soon as the RPi is heard again
+  TEST_ASSERT_TRUE(clockSyncSample(sync, SYNC_RPI, 300000, SYNC_TTL_MS + 20));
+  TEST_ASSERT_EQUAL(SYNC_RPI, clockSyncSource(sync, SYNC_TTL_MS + 30));
+  TEST_ASSERT_EQUAL_UINT32(3, sync.steps);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unsynced_is_local_time);
+  RUN_TEST(test_first_sample_steps);
+  RUN_TEST(test_tracks_drift_and_offset);
+  RUN_TEST(test_nodes_agree);
+  RUN_TEST(test_reference_restart_steps);
+  RUN_TEST(test_master_only_while_rpi_silent);
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+#include <unity.h>
+
+#include "swarm_election.h"
+
+static NodeTable table;
+static ElectionState election;
+
+static const uint32_t SELF_KEY = 0x0500A8C0;
+static const uint16_t SELF_ID  = 5;
+
+void setUp() {
+  nodeTableInit(table, nullptr);
+  election = ElectionState();
+}
+
+void tearDown() {}
+
+static void peer(uint32_t key, uint16_t id, uint16_t value, bool master, uint32_t now) {
+  static uint16_t seq = 0;
+  SwarmFrame f = {};
+  f.type        = SWARM_TYPE_READING;
+  f.flags       = master ? SWARM_FLAG_MASTER : 0;
+  f.nodeId      = id;
+  f.reading     = value;
+  f.seq         = ++seq;
+  f.timestampMs = now;
+  nodeTableStore(table, key, f, false, now);
+}
+
+static bool elect(int value, bool isMaster, uint32_t now) {
+  ElectionSelf self = {value, SELF_ID, SELF_KEY};
+  return electMaster(table, election, self, isMaster, now);
+}
+
+static void test_alone_stays_master() {
+  TEST_ASSERT_TRUE(elect(100, true, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, election.roleChanges);
+}
+
+static void test_brighter_peer_takes_over_beyond_hysteresis() {
+  peer(0x10, 1, 500 + HYSTERESIS, false, 0);
+  TEST_ASSERT_TRUE(elect(500, true, 0));  // inside the margin: keep the role
+
+  peer(0x10, 1, 500 + HYSTERESIS + 1, false, 10);
+  TEST_ASSERT_FALSE(elect(500, true, 10));
+  TEST_ASSERT_EQUAL_UINT32(1, election.roleChanges);
+}
+
+static void test_challenger_needs_the_same_margin() {
+  peer(0x10, 1, 500, true, 0);
+  TEST_ASSERT_FALSE(elect(500 + HYSTERESIS, false, 0));
+  TEST_ASSERT_TRUE(elect(500 + HYSTERESIS + 1, false, 0));
+}
+
+static void test_tie_goes_to_lower_node_id() {
+  peer(0x10, SELF_ID + 1, 400, false, 0);
+  TEST_ASSERT_TRUE(elect(400, false, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, election.tieBreaks);
+
+  setUp();
+  peer(0x10, SELF_ID - 1, 400, false, 0);
+  TEST_ASSERT_FALSE(elect(400, false, 0));
+}
+
+static void test_minimum_hold_blocks_flapping() {
+  peer(0x10, 1, 900, true, 0);
+  TEST_ASSERT_FALSE(elect(100, true, 0));
+
+  // The peer goes quiet and we are the best again, but the hold is still running
+  peer(0x10, 1, 0, false, 1);
+  TEST_ASSERT_FALSE(elect(100, false, ROLE_MIN_HOLD_MS - 1));
+  TEST_ASSERT_TRUE(elect(100, false, ROLE_MIN_HOLD_MS));
+}
+
+static void test_counts_suppressed_flips() {
+  // Hysteresis: the peer ranks above us but inside the margin
+  peer(0x10, 1, 500 + HYSTERESIS, false, 0);
+  TEST_ASSERT_TRUE(elect(500, true, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, election.flipsSuppressed);
+
+  // A plain win or loss is not a suppressed flip
+  TEST_ASSERT_FALSE(elect(500, false, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, election.flipsSuppressed);
+
+  // Hold: we flip, then the ranking turns straight back
+  peer(0x10, 1, 500 + HYSTERESIS + 1, false, 10);
+  TEST_ASSERT_FALSE(elect(500, true, 10));
+  TEST_ASSERT_EQUAL_UINT32(1, election.flipsSuppressed);
+  peer(0x10, 1, 0, false, 20);
+  TEST_ASSERT_FALSE(elect(500, false, 20));
+  TEST_ASSERT_EQUAL_UINT32(2, election.flipsSuppressed);
+  TEST_ASSERT_TRUE(elect(500, false, 10 + ROLE_MIN_HOLD_MS));
+  TEST_ASSERT_EQUAL_UINT32(2, election.flipsSuppressed);
+}
+
+static void test_tuned_hysteresis() {
+  election.hysteresis = 0;
+  peer(0x10, 1, 501, false, 0);
+  TEST_ASSERT_FALSE(elect(500, true, 0));
+}
+
+static void test_dual_master_lower_rank_yields() {
+  // After a partition heals both sides claim MASTER with readings inside the margin
+  peer(0x10, 1, 505, true, 0);
+  TEST_ASSERT_FALSE(elect(500, true, 0));
+}
+
+static void test_dead_master_is_replaced() {
+  peer(0x10, 1, 900, true, 0);
+  TEST_ASSERT_FALSE(elect(100, false, 0));
+  TEST_ASSERT_TRUE(elect(100, false, PEER_TTL_MS + 1));
+  TEST_ASSERT_EQUAL_UINT16(0, table.count);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_alone_stays_master);
+  RUN_TEST(test_brighter_peer_takes_over_beyond_hysteresis);
+  RUN_TEST(test_challenger_needs_the_same_margin);
+  RUN_TEST(test_tie_goes_to_lower_node_id);
+  RUN_TEST(test_minimum_hold_blocks_flapping);
+  RUN_TEST(test_counts_suppressed_flips);
+  RUN_TEST(test_tuned_hysteresis);
+  RUN_TEST(test_dual_master_lower_rank_yields);
+  RUN_TEST(test_dead_master_is_replaced);
+  return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "swarm_config.h"
+#include "swarm_frame.h"
+
+void setUp() {}
+void tearDown() {}
+
+static SwarmFrame sampleFrame() {
+  SwarmFrame f = {};
+  f.type        = SWARM_TYPE_READING;
+  f.flags       = SWARM_FLAG_MASTER;
+  f.nodeId      = 0x1234;
+  f.reading     = 987;
+  f.seq         = 0xBEEF;
+  f.timestampMs = 0xDEADBEEF;
+  return f;
+}
+
+static void test_crc_matches_ccitt_false() {
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16Ccitt(check, sizeof(check)));
+}
+
+static void test_round_trip() {
+  uint8_t buf[SWARM_FRAME_LEN];
+  SwarmFrame in = sampleFrame();
+  TEST_ASSERT_EQUAL(SWARM_FRAME_LEN, encodeSwarmFrame(buf, in));
+  TEST_ASSERT_TRUE(isSwarmFrame(buf, sizeof(buf)));
+
+  SwarmFrame out;
+  TEST_ASSERT_TRUE(decodeSwarmFrame(buf, sizeof(buf), &out));
+  TEST_ASSERT_EQUAL_UINT8(in.type, out.type);
+  TEST_ASSERT_EQUAL_UINT8(in.flags, out.flags);
+  TEST_ASSERT_EQUAL_UINT16(in.nodeId, out.nodeId);
+  TEST_ASSERT_EQUAL_UINT16(in.reading, out.reading);
+  TEST_ASSERT_EQUAL_UINT16(in.seq, out.seq);
+  TEST_ASSERT_EQUAL_UINT32(in.timestampMs, out.timestampMs);
+}
+
+static void test_wire_layout_is_little_endian() {
+  uint8_t buf[SWARM_FRAME_LEN];
+  encodeSwarmFrame(buf, sampleFrame());
+  TEST_ASSERT_EQUAL_HEX8(SWARM_MAGIC, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8((SWARM_VERSION << 4) | SWARM_FLAG_MASTER | SWARM_TYPE_READING, buf[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x34, buf[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x12, buf[3]);
+  TEST_ASSERT_EQUAL_HEX8(0xEF, buf[8]);
+  TEST_ASSERT_EQUAL_HEX8(0xDE, buf[11]);
+}
+
+static void test_rejects_any_single_bit_flip() {
+  uint8_t good[SWARM_FRAME_LEN];
+  encodeSwarmFrame(good, sampleFrame());
+  for (size_t byte = 0; byte < SWARM_FRAME_LEN; byte++) {
+    for (int bit = 0; bit < 8; bit++) {
+      uint8_t buf[SWARM_FRAME_LEN];
+      memcpy(buf, good, sizeof(buf));
+      buf[byte] ^= (uint8_t)(1 << bit);
+      SwarmFrame out;
+      TEST_ASSERT_FALSE(decodeSwarmFrame(buf, sizeof(buf), &out));
+    }
+  }
+}
+
+static void test_rejects_wrong_length_and_version() {
+  uint8_t buf[SWARM_FRAME_LEN + 1];
+  encodeSwarmFrame(buf, sampleFrame());
+  SwarmFrame out;
+  TEST_ASSERT_FALSE(decodeSwarmFrame(buf, SWARM_FRAME_LEN - 1, &out));
+  TEST_ASSERT_FALSE(decodeSwarmFrame(buf, SWARM_FRAME_LEN + 1, &out));
+  TEST_ASSERT_FALSE(isSwarmFrame((const uint8_t*)"~~~1,2---", 9));
+}
+
+static void test_ascii_reading() {
+  const char msg[] = "~~~42,1023---";
+  SwarmFrame f;
+  TEST_ASSERT_EQUAL(ASCII_READING, decodeAsciiReading(msg, strlen(msg), &f));
+  TEST_ASSERT_EQUAL_UINT8(SWARM_TYPE_READING, f.type);
+  TEST_ASSERT_EQUAL_UINT16(42, f.nodeId);
+  TEST_ASSERT_EQUAL_UINT16(1023, f.reading);
+  TEST_ASSERT_EQUAL_UINT16(0, f.seq);
+}
+
+static void test_ascii_malformed_and_foreign() {
+  const char* malformed[] = {"~~~---", "~~~42---", "~~~42,---", "~~~a,1---", "~~~1,2,3---",
+                             "~~~-1,5---", "~~~1,-5---", "~~~1234567890,1---"};
+  SwarmFrame f;
+  for (const char* m : malformed) {
+    TEST_ASSERT_EQUAL_MESSAGE(ASCII_MALFORMED, decodeAsciiReading(m, strlen(m), &f), m);
+  }
+  const char* foreign[] = {"+++RESET_REQUESTED***", "~~~1,2", "", "~~"};
+  for (const char* m : foreign) {
+    TEST_ASSERT_EQUAL_MESSAGE(ASCII_NOT_READING, decodeAsciiReading(m, strlen(m), &f), m);
+  }
+}
+
+// The receive path of the pre-binary firmware, which upgraded nodes must
+// still reach during a rolling upgrade
+static bool baselineAccepts(const char* pkt, int* rid, int* rval) {
+  size_t len = strlen(pkt);
+  if (len < 6 || strncmp(pkt, "~~~", 3) != 0 || strcmp(pkt + len - 3, "---") != 0) return false;
+  char data[64];
+  memcpy(data, pkt + 3, len - 6);
+  data[len - 6] = '\0';
+  *rid = -1;
+  *rval = -1;
+  return sscanf(data, "%d,%d", rid, rval) == 2 && *rid >= 0 && *rid < MAX_SWARM_LEGACY;
+}
+
+static void test_legacy_tx_parses_under_baseline_rules() {
+  const uint8_t octets[] = {0, 9, 10, 57, 199, 255};
+  for (uint8_t octet : octets) {
+    char msg[32];
+    size_t n = encodeAsciiReading(msg, sizeof(msg), legacyAsciiId(octet), 1023);
+    TEST_ASSERT_TRUE(n > 0);
+    int rid, rval;
+    TEST_ASSERT_TRUE(baselineAccepts(msg, &rid, &rval));
+    TEST_ASSERT_EQUAL_INT(octet % 10, rid);
+    TEST_ASSERT_EQUAL_INT(1023, rval);
+
+    SwarmFrame f;
+    TEST_ASSERT_EQUAL(ASCII_READING, decodeAsciiReading(msg, n, &f));
+    TEST_ASSERT_EQUAL_UINT16(octet % 10, f.nodeId);
+  }
+
+  // A wide swarm ID is exactly what the baseline drops
+  char msg[32];
+  int rid, rval;
+  encodeAsciiReading(msg, sizeof(msg), 0xBEEF, 500);
+  TEST_ASSERT_FALSE(baselineAccepts(msg, &rid, &rval));
+  TEST_ASSERT_EQUAL_UINT32(0, encodeAsciiReading(msg, 8, 1, 500));
+}
+
+static void test_payload_helpers() {
+  const char msg[] = "+++RPI_BEACON***";
+  size_t n = 0;
+  const char* p = framePayload(msg, strlen(msg), RPI_START, RPI_END, &n);
+  TEST_ASSERT_NOT_NULL(p);
+  TEST_ASSERT_TRUE(payloadEquals(p, n, "RPI_BEACON"));
+  TEST_ASSERT_FALSE(payloadEquals(p, n, "RPI_BEACONS"));
+  TEST_ASSERT_NULL(framePayload("+++*", 4, RPI_START, RPI_END, &n));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_matches_ccitt_false);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_wire_layout_is_little_endian);
+  RUN_TEST(test_rejects_any_single_bit_flip);
+  RUN_TEST(test_rejects_wrong_length_and_version);
+  RUN_TEST(test_ascii_reading);
+  RUN_TEST(test_ascii_malformed_and_foreign);
+  RUN_TEST(test_legacy_tx_parses_under_baseline_rules);
+  RUN_TEST(test_payload_helpers);
+  return UNITY_END();
+}
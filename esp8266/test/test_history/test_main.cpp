@@ -0,0 +1,118 @@
+#include <stdint.h>
+#include <unity.h>
+
+#include "history.h"
+
+static const uint32_t PERIOD = 1000;
+
+static HistoryRing ring;
+static int evictions = 0;
+static uint32_t lastEvictedSeq = 0;
+
+static void countEvict(const HistoryBlock& b) {
+  evictions++;
+  lastEvictedSeq = b.firstSeq;
+}
+
+void setUp() {
+  historyInit(ring, PERIOD, countEvict);
+  evictions = 0;
+}
+
+void tearDown() {}
+
+static uint32_t rng = 777;
+static uint32_t nextRand() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+// Decodes the whole ring oldest-first into out; returns the sample count
+static uint32_t decodeAll(uint16_t* out, uint32_t* firstSeq) {
+  uint32_t n = 0;
+  uint16_t vals[HISTORY_BLOCK_MAX_SAMPLES];
+  for (uint16_t i = 0; const HistoryBlock* b = historyBlockAt(ring, i); i++) {
+    if (i == 0) *firstSeq = b->firstSeq;
+    uint8_t k = historyDecode(*b, vals);
+    TEST_ASSERT_EQUAL_UINT8(b->count, k);
+    for (uint8_t j = 0; j < k; j++) out[n++] = vals[j];
+  }
+  return n;
+}
+
+static void test_round_trip_full_range() {
+  static uint16_t in[4000], out[4000];
+  uint32_t n = HISTORY_BLOCKS * 8;  // large steps: two bytes each, stays in RAM
+  for (uint32_t i = 0; i < n; i++) {
+    in[i] = (uint16_t)(i % 3 == 0 ? 0 : (i % 3 == 1 ? 1024 : nextRand() % 1025));
+    historyAppend(ring, in[i], i * PERIOD);
+  }
+  uint32_t first = 0;
+  TEST_ASSERT_EQUAL_UINT32(n, decodeAll(out, &first));
+  TEST_ASSERT_EQUAL_UINT32(0, first);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(in, out, n);
+  TEST_ASSERT_EQUAL_INT(0, evictions);
+}
+
+static void test_small_steps_take_one_byte() {
+  for (uint32_t i = 0; i < HISTORY_BLOCK_MAX_SAMPLES; i++) {
+    historyAppend(ring, (uint16_t)(500 + (i & 1 ? 63 : 0)), i * PERIOD);
+  }
+  TEST_ASSERT_EQUAL_UINT16(1, ring.blocks);
+  TEST_ASSERT_EQUAL_UINT8(HISTORY_BLOCK_MAX_SAMPLES, historyBlockAt(ring, 0)->count);
+
+  historyAppend(ring, 500, HISTORY_BLOCK_MAX_SAMPLES * PERIOD);
+  TEST_ASSERT_EQUAL_UINT16(2, ring.blocks);
+}
+
+static void test_time_gap_starts_new_block() {
+  historyAppend(ring, 10, 0);
+  historyAppend(ring, 11, PERIOD);
+  historyAppend(ring, 12, 5 * PERIOD);  // loop stalled for three periods
+  TEST_ASSERT_EQUAL_UINT16(2, ring.blocks);
+  const HistoryBlock* b = historyBlockAt(ring, 1);
+  TEST_ASSERT_EQUAL_UINT32(2, b->firstSeq);
+  TEST_ASSERT_EQUAL_UINT32(5 * PERIOD, b->firstMs);
+  TEST_ASSERT_FALSE(historyContiguous(*historyBlockAt(ring, 0), *b, PERIOD));
+}
+
+static void test_eviction_keeps_newest() {
+  static uint16_t out[HISTORY_BLOCKS * HISTORY_BLOCK_MAX_SAMPLES];
+  uint32_t total = HISTORY_BLOCKS * HISTORY_BLOCK_MAX_SAMPLES * 3;
+  for (uint32_t i = 0; i < total; i++) historyAppend(ring, (uint16_t)(i % 1000), i * PERIOD);
+
+  TEST_ASSERT_EQUAL_UINT16(HISTORY_BLOCKS, ring.blocks);
+  TEST_ASSERT_EQUAL_INT((int)ring.evicted, evictions);
+  TEST_ASSERT_TRUE(evictions > 0);
+
+  uint32_t first = 0;
+  uint32_t n = decodeAll(out, &first);
+  TEST_ASSERT_EQUAL_UINT32(total, first + n);
+  TEST_ASSERT_TRUE(lastEvictedSeq < first);
+  for (uint32_t i = 0; i < n; i++) TEST_ASSERT_EQUAL_UINT16((first + i) % 1000, out[i]);
+
+  for (uint16_t i = 1; i < ring.blocks; i++) {
+    TEST_ASSERT_TRUE(historyContiguous(*historyBlockAt(ring, i - 1), *historyBlockAt(ring, i), PERIOD));
+  }
+}
+
+static void test_find() {
+  for (uint32_t i = 0; i < 300; i++) historyAppend(ring, (uint16_t)(i * 7 % 1025), i * PERIOD);
+  const HistoryBlock* b = historyFind(ring, 150);
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_TRUE(b->firstSeq <= 150 && 150 < b->firstSeq + b->count);
+  TEST_ASSERT_EQUAL_PTR(historyBlockAt(ring, 0), historyFind(ring, 0));
+  TEST_ASSERT_NULL(historyFind(ring, 300));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_full_range);
+  RUN_TEST(test_small_steps_take_one_byte);
+  RUN_TEST(test_time_gap_starts_new_block);
+  RUN_TEST(test_eviction_keeps_newest);
+  RUN_TEST(test_find);
+  return UNITY_END();
+}
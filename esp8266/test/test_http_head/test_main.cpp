@@ -0,0 +1,108 @@
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "http_head.h"
+
+static HttpHead head;
+
+void setUp() {
+  httpHeadInit(head);
+}
+
+void tearDown() {}
+
+// Feeds s and returns the result of its last byte
+static HttpHeadResult feed(const char* s) {
+  HttpHeadResult r = HTTP_HEAD_MORE;
+  while (*s != '\0') {
+    r = httpHeadPush(head, *s++);
+    if (r != HTTP_HEAD_MORE) break;
+  }
+  return r;
+}
+
+static void test_ok_with_length() {
+  TEST_ASSERT_EQUAL(HTTP_HEAD_DONE,
+                    feed("HTTP/1.0 200 OK\r\nServer: SimpleHTTP/0.6\r\ncontent-LENGTH:  412096\r\n\r\n"));
+  TEST_ASSERT_EQUAL_INT(200, head.status);
+  TEST_ASSERT_EQUAL_INT32(412096, head.contentLength);
+}
+
+static void test_stops_at_body() {
+  const char* s = "HTTP/1.1 200 OK\nContent-Length: 3\n\nabc";
+  size_t i = 0;
+  HttpHeadResult r = HTTP_HEAD_MORE;
+  while (r == HTTP_HEAD_MORE) r = httpHeadPush(head, s[i++]);
+  TEST_ASSERT_EQUAL(HTTP_HEAD_DONE, r);
+  TEST_ASSERT_EQUAL_STRING("abc", s + i);
+}
+
+static void test_in_pieces() {
+  TEST_ASSERT_EQUAL(HTTP_HEAD_MORE, feed("HTTP/1.1 40"));
+  TEST_ASSERT_EQUAL(HTTP_HEAD_MORE, feed("4 Not Found\r\n"));
+  TEST_ASSERT_EQUAL_INT(404, head.status);
+  TEST_ASSERT_EQUAL(HTTP_HEAD_DONE, feed("\r\n"));
+  TEST_ASSERT_EQUAL_INT32(-1, head.contentLength);
+}
+
+static void test_long_lines_are_skipped() {
+  char line[200];
+  memset(line, 'x', sizeof(line));
+  memcpy(line, "X-Pad: ", 7);
+  line[sizeof(line) - 3] = '\r';
+  line[sizeof(line) - 2] = '\n';
+  line[sizeof(line) - 1] = '\0';
+  feed("HTTP/1.1 200 OK\r\n");
+  TEST_ASSERT_EQUAL(HTTP_HEAD_MORE, feed(line));
+  TEST_ASSERT_EQUAL(HTTP_HEAD_DONE, feed("Content-Length: 10\r\n\r\n"));
+  TEST_ASSERT_EQUAL_INT32(10, head.contentLength);
+}
+
+static void test_bad_responses() {
+  TEST_ASSERT_EQUAL(HTTP_HEAD_BAD, feed("SSH-2.0-OpenSSH_9.2\r\n"));
+  httpHeadInit(head);
+  TEST_ASSERT_EQUAL(HTTP_HEAD_BAD, feed("\r\n"));
+  httpHeadInit(head);
+  TEST_ASSERT_EQUAL(HTTP_HEAD_BAD, feed("HTTP/1.1 2x0 OK\r\n"));
+
+  // A server that never ends its head
+  httpHeadInit(head);
+  feed("HTTP/1.1 200 OK\r\n");
+  HttpHeadResult r = HTTP_HEAD_MORE;
+  for (uint16_t i = 0; i < HTTP_HEAD_MAX_BYTES && r == HTTP_HEAD_MORE; i++) r = httpHeadPush(head, 'a');
+  TEST_ASSERT_EQUAL(HTTP_HEAD_BAD, r);
+}
+
+static void test_parse_url() {
+  char host[16];
+  uint16_t port = 0;
+  const char* path = nullptr;
+  TEST_ASSERT_TRUE(httpParseUrl("http://192.168.1.10:8000/firmware.bin", host, sizeof(host), &port, &path));
+  TEST_ASSERT_EQUAL_STRING("192.168.1.10", host);
+  TEST_ASSERT_EQUAL_UINT16(8000, port);
+  TEST_ASSERT_EQUAL_STRING("/firmware.bin", path);
+
+  TEST_ASSERT_TRUE(httpParseUrl("http://10.0.0.2", host, sizeof(host), &port, &path));
+  TEST_ASSERT_EQUAL_STRING("10.0.0.2", host);
+  TEST_ASSERT_EQUAL_UINT16(80, port);
+  TEST_ASSERT_EQUAL_STRING("/", path);
+
+  TEST_ASSERT_FALSE(httpParseUrl("https://10.0.0.2/a", host, sizeof(host), &port, &path));
+  TEST_ASSERT_FALSE(httpParseUrl("http:///a", host, sizeof(host), &port, &path));
+  TEST_ASSERT_FALSE(httpParseUrl("http://10.0.0.2:/a", host, sizeof(host), &port, &path));
+  TEST_ASSERT_FALSE(httpParseUrl("http://10.0.0.2:70000/a", host, sizeof(host), &port, &path));
+  TEST_ASSERT_FALSE(httpParseUrl("http://10.0.0.2:80x/a", host, sizeof(host), &port, &path));
+  TEST_ASSERT_FALSE(httpParseUrl("http://a-very-long-host-name.lan/a", host, sizeof(host), &port, &path));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ok_with_length);
+  RUN_TEST(test_stops_at_body);
+  RUN_TEST(test_in_pieces);
+  RUN_TEST(test_long_lines_are_skipped);
+  RUN_TEST(test_bad_responses);
+  RUN_TEST(test_parse_url);
+  return UNITY_END();
+}
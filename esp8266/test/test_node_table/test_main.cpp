@@ -0,0 +1,292 @@
+#include <stdint.h>
+#include <unity.h>
+
+#include "node_table.h"
+
+static NodeTable table;
+static int expiredCalls = 0;
+
+static void countExpired(const NodeTable&, int, uint32_t) {
+  expiredCalls++;
+}
+
+void setUp() {
+  nodeTableInit(table, countExpired);
+  expiredCalls = 0;
+}
+
+void tearDown() {}
+
+static SwarmFrame reading(uint16_t id, uint16_t value, uint16_t seq, uint32_t ts = 0) {
+  SwarmFrame f = {};
+  f.type        = SWARM_TYPE_READING;
+  f.nodeId      = id;
+  f.reading     = value;
+  f.seq         = seq;
+  f.timestampMs = ts;
+  return f;
+}
+
+static int findSlot(uint32_t key) {
+  for (int i = 0; i < NODE_TABLE_SIZE; i++) {
+    if (table.key[i] == key) return i;
+  }
+  return -1;
+}
+
+// Brute-force reference for nodeTableLeader()
+static int bestSlot() {
+  int best = -1;
+  for (int i = 0; i < NODE_TABLE_SIZE; i++) {
+    if (table.key[i] == 0) continue;
+    if (best < 0 || outranks(table.reading[i], table.nodeId[i], table.key[i],
+                             table.reading[best], table.nodeId[best], table.key[best])) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+// Every stored key must be reachable from its home slot without crossing a hole
+static bool probeChainsIntact() {
+  for (int i = 0; i < NODE_TABLE_SIZE; i++) {
+    if (table.key[i] == 0) continue;
+    for (uint16_t s = nodeSlot(table.key[i]); s != i; s = (s + 1) & NODE_TABLE_MASK) {
+      if (table.key[s] == 0) return false;
+    }
+  }
+  return true;
+}
+
+static uint32_t rng = 12345;
+static uint32_t nextRand() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void test_insert_and_update() {
+  TEST_ASSERT_TRUE(nodeTableStore(table, 0x0A00A8C0, reading(10, 500, 1), false, 100));
+  TEST_ASSERT_TRUE(nodeTableStore(table, 0x0B00A8C0, reading(11, 600, 1), false, 100));
+  TEST_ASSERT_EQUAL_UINT16(2, table.count);
+
+  TEST_ASSERT_TRUE(nodeTableStore(table, 0x0A00A8C0, reading(10, 700, 2), false, 200));
+  TEST_ASSERT_EQUAL_UINT16(2, table.count);
+  int slot = findSlot(0x0A00A8C0);
+  TEST_ASSERT_EQUAL_INT16(700, table.reading[slot]);
+  TEST_ASSERT_EQUAL_INT(slot, nodeTableLeader(table, 200));
+}
+
+static void test_full_table_counts_failures() {
+  for (uint32_t i = 1; i <= NODE_TABLE_SIZE; i++) {
+    TEST_ASSERT_TRUE(nodeTableStore(table, i, reading((uint16_t)i, 1, 1), false, 0));
+  }
+  TEST_ASSERT_FALSE(nodeTableStore(table, NODE_TABLE_SIZE + 1, reading(0, 1, 1), false, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, table.insertFailures);
+}
+
+static void test_equal_readings_break_on_node_id() {
+  nodeTableStore(table, 0x30, reading(7, 400, 1), false, 0);
+  nodeTableStore(table, 0x20, reading(3, 400, 1), false, 0);
+  nodeTableStore(table, 0x10, reading(5, 400, 1), false, 0);
+  TEST_ASSERT_EQUAL_INT(findSlot(0x20), nodeTableLeader(table, 0));
+}
+
+// Random inserts, updates and removals against the brute-force leader and the
+// probe-chain invariant of backward-shift deletion
+static void test_fuzz_leader_and_removal() {
+  uint16_t seq[256] = {};
+  for (int step = 0; step < 20000; step++) {
+    uint32_t key = 1 + nextRand() % (NODE_TABLE_SIZE + NODE_TABLE_SIZE / 2);
+    uint32_t op = nextRand() % 10;
+    int slot = findSlot(key);
+    if (op < 3 && slot >= 0) {
+      nodeTableRemove(table, slot);
+    } else {
+      uint16_t k = (uint16_t)(key & 0xFF);
+      SwarmFrame f = reading(k % 16, (uint16_t)(nextRand() % 1025), ++seq[k]);
+      if (nextRand() % 4 == 0) f.flags = SWARM_FLAG_MASTER;
+      nodeTableStore(table, key, f, false, 0);
+    }
+    TEST_ASSERT_TRUE(probeChainsIntact());
+    TEST_ASSERT_TRUE(table.masterSlot < 0 || table.key[table.masterSlot] != 0);
+    int leader = nodeTableLeader(table, 0);
+    TEST_ASSERT_EQUAL_INT(bestSlot(), leader);
+  }
+}
+
+// Removing an entry back-shifts its probe-chain successors; role pointers
+// must follow the moved entry, not stay on the vacated slot
+static void test_removal_moves_master_pointer() {
+  uint32_t keys[2];
+  int found = 0;
+  uint16_t home = nodeSlot(1);
+  keys[found++] = 1;
+  for (uint32_t k = 2; found < 2; k++) {
+    if (nodeSlot(k) == home) keys[found++] = k;
+  }
+
+  nodeTableStore(table, keys[0], reading(1, 100, 1), false, 0);
+  SwarmFrame f = reading(2, 900, 1);
+  f.flags = SWARM_FLAG_MASTER;
+  nodeTableStore(table, keys[1], f, false, 0);
+  TEST_ASSERT_EQUAL_INT((home + 1) & NODE_TABLE_MASK, findSlot(keys[1]));
+
+  nodeTableRemove(table, findSlot(keys[0]));
+  TEST_ASSERT_EQUAL_INT(home, findSlot(keys[1]));
+  TEST_ASSERT_EQUAL_INT(home, nodeTableMasterPeer(table, 0));
+  TEST_ASSERT_EQUAL_INT(home, nodeTableLeader(table, 0));
+}
+
+static void test_ttl_expiry() {
+  nodeTableStore(table, 0x10, reading(1, 900, 1), false, 0);
+  nodeTableStore(table, 0x20, reading(2, 100, 1), false, PEER_TTL_MS);
+
+  // The leader is stale: asking for it evicts it and falls back
+  TEST_ASSERT_EQUAL_INT(findSlot(0x20), nodeTableLeader(table, PEER_TTL_MS + 1));
+  TEST_ASSERT_EQUAL_INT(1, expiredCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, table.expired);
+
+  for (int i = 0; i < NODE_TABLE_SIZE; i++) nodeTableSweep(table, 3 * PEER_TTL_MS);
+  TEST_ASSERT_EQUAL_UINT16(0, table.count);
+  TEST_ASSERT_EQUAL_INT(-1, nodeTableLeader(table, 3 * PEER_TTL_MS));
+}
+
+static void test_tuned_ttl() {
+  table.ttlMs = 500;
+  nodeTableStore(table, 0x10, reading(1, 900, 1), false, 0);
+  TEST_ASSERT_EQUAL_INT(findSlot(0x10), nodeTableLeader(table, 500));
+  TEST_ASSERT_EQUAL_INT(-1, nodeTableLeader(table, 501));
+}
+
+static void test_master_claims() {
+  SwarmFrame f = reading(1, 300, 1);
+  f.flags = SWARM_FLAG_MASTER;
+  nodeTableStore(table, 0x10, f, false, 0);
+  TEST_ASSERT_EQUAL_INT(findSlot(0x10), nodeTableMasterPeer(table, 0));
+
+  f.flags = 0;
+  f.seq = 2;
+  nodeTableStore(table, 0x10, f, false, 0);
+  TEST_ASSERT_EQUAL_INT(-1, nodeTableMasterPeer(table, 0));
+}
+
+static void test_sequence_accounting() {
+  const uint32_t key = 0x10;
+  nodeTableStore(table, key, reading(1, 100, 10, 0), false, 5);
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 110, 13, 200), false, 205));
+  TEST_ASSERT_EQUAL_UINT32(2, table.seqLost);
+
+  // Duplicate and late frames must not overwrite the newer reading
+  TEST_ASSERT_FALSE(nodeTableStore(table, key, reading(1, 999, 13, 200), false, 206));
+  TEST_ASSERT_FALSE(nodeTableStore(table, key, reading(1, 999, 12, 100), false, 207));
+  TEST_ASSERT_EQUAL_UINT32(1, table.seqDuplicates);
+  TEST_ASSERT_EQUAL_UINT32(1, table.seqReordered);
+  TEST_ASSERT_EQUAL_INT16(110, table.reading[findSlot(key)]);
+
+  // A large jump is a reboot, not thousands of lost frames
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 120, 13 + 5000, 300), false, 305));
+  TEST_ASSERT_EQUAL_UINT32(1, table.seqResyncs);
+  TEST_ASSERT_EQUAL_UINT32(2, table.seqLost);
+
+  // 16-bit wrap is an ordinary step
+  nodeTableStore(table, key, reading(1, 120, 0xFFFF, 400), false, 405);
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 120, 1, 500), false, 505));
+  TEST_ASSERT_EQUAL_UINT32(3, table.seqLost);
+}
+
+// ASCII frames carry no sequence, so the next binary frame starts afresh
+static void test_ascii_then_binary_is_a_new_baseline() {
+  const uint32_t key = 0x10;
+  SwarmFrame ascii = reading(1, 100, 0);
+  nodeTableStore(table, key, ascii, true, 0);
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 110, 500, 100), false, 105));
+  TEST_ASSERT_EQUAL_UINT32(0, table.seqLost);
+
+  nodeTableStore(table, key, ascii, true, 200);
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 120, 65000, 300), false, 305));
+  TEST_ASSERT_EQUAL_INT16(120, table.reading[findSlot(key)]);
+  TEST_ASSERT_EQUAL_UINT32(0, table.seqReordered);
+  TEST_ASSERT_EQUAL_UINT32(0, table.seqResyncs);
+
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 120, 65002, 400), false, 405));
+  TEST_ASSERT_EQUAL_UINT32(1, table.seqLost);
+}
+
+// Sequence 0 is an ordinary value, not "no baseline"
+static void test_seq_wrap_to_zero() {
+  const uint32_t key = 0x10;
+  nodeTableStore(table, key, reading(1, 100, 0xFFFF, 0), false, 5);
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 100, 0, 100), false, 105));
+  TEST_ASSERT_FALSE(nodeTableStore(table, key, reading(1, 999, 0, 100), false, 106));
+  TEST_ASSERT_EQUAL_UINT32(1, table.seqDuplicates);
+  TEST_ASSERT_EQUAL_UINT32(0, table.seqLost);
+  TEST_ASSERT_TRUE(nodeTableStore(table, key, reading(1, 100, 1, 200), false, 205));
+  TEST_ASSERT_EQUAL_UINT32(0, table.seqLost);
+  TEST_ASSERT_EQUAL_INT16(100, table.reading[findSlot(key)]);
+}
+
+static void test_shared_id_at_two_addresses() {
+  nodeTableStore(table, 0x10, reading(7, 500, 1), false, 0);
+  nodeTableStore(table, 0x10, reading(7, 510, 2), false, 10);
+  TEST_ASSERT_EQUAL_UINT32(0, table.idCollisions);
+
+  nodeTableStore(table, 0x20, reading(7, 300, 1), false, 20);
+  TEST_ASSERT_EQUAL_UINT32(1, table.idCollisions);
+  TEST_ASSERT_EQUAL_UINT32(0x10, table.collisionKey);
+  TEST_ASSERT_EQUAL_UINT16(2, table.count);  // both are kept
+  nodeTableStore(table, 0x20, reading(7, 310, 2), false, 30);
+  TEST_ASSERT_EQUAL_UINT32(1, table.idCollisions);
+
+  // An expired entry does not count: that node has moved, not collided
+  nodeTableStore(table, 0x30, reading(7, 300, 1), false, 40 + PEER_TTL_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, table.idCollisions);
+
+  // Nor do ASCII readings, whose IDs are only ip[3] % 10
+  nodeTableStore(table, 0x40, reading(7, 300, 0), true, 50 + PEER_TTL_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, table.idCollisions);
+}
+
+static void test_jitter_estimate() {
+  const uint32_t key = 0x10;
+  // Constant transit: no jitter
+  for (uint16_t i = 1; i <= 50; i++) nodeTableStore(table, key, reading(1, 1, i, i * 100), false, i * 100 + 7);
+  TEST_ASSERT_EQUAL_UINT32(0, nodeTableMeanJitterMs(table));
+
+  // Transit alternating by 20 ms converges towards 20 ms
+  for (uint16_t i = 51; i <= 300; i++) {
+    nodeTableStore(table, key, reading(1, 1, i, i * 100), false, i * 100 + ((i & 1) ? 27 : 7));
+  }
+  uint32_t j = nodeTableMeanJitterMs(table);
+  TEST_ASSERT_TRUE(j >= 18 && j <= 20);
+}
+
+static void test_clear_keeps_counters_and_hook() {
+  nodeTableStore(table, 0x10, reading(1, 1, 1), false, 0);
+  nodeTableStore(table, 0x10, reading(1, 1, 5), false, 0);
+  nodeTableClear(table);
+  TEST_ASSERT_EQUAL_UINT16(0, table.count);
+  TEST_ASSERT_EQUAL_UINT32(3, table.seqLost);
+  TEST_ASSERT_TRUE(table.onExpire == countExpired);
+  TEST_ASSERT_EQUAL_INT(-1, nodeTableLeader(table, 0));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_insert_and_update);
+  RUN_TEST(test_full_table_counts_failures);
+  RUN_TEST(test_equal_readings_break_on_node_id);
+  RUN_TEST(test_fuzz_leader_and_removal);
+  RUN_TEST(test_removal_moves_master_pointer);
+  RUN_TEST(test_ttl_expiry);
+  RUN_TEST(test_tuned_ttl);
+  RUN_TEST(test_master_claims);
+  RUN_TEST(test_sequence_accounting);
+  RUN_TEST(test_ascii_then_binary_is_a_new_baseline);
+  RUN_TEST(test_seq_wrap_to_zero);
+  RUN_TEST(test_shared_id_at_two_addresses);
+  RUN_TEST(test_jitter_estimate);
+  RUN_TEST(test_clear_keeps_counters_and_hook);
+  return UNITY_END();
+}
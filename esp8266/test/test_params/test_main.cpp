@@ -0,0 +1,110 @@
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "swarm_params.h"
+
+static SwarmParams params;
+
+void setUp() {
+  paramsDefaults(params);
+}
+
+void tearDown() {}
+
+static int find(const char* name) {
+  return paramFind(name, strlen(name));
+}
+
+static void test_defaults_are_valid() {
+  TEST_ASSERT_TRUE(paramsValid(params));
+  TEST_ASSERT_EQUAL_UINT32(SILENT_MS, params.silentMs);
+  TEST_ASSERT_EQUAL_UINT32(PEER_TTL_MS, params.peerTtlMs);
+}
+
+static void test_names_round_trip() {
+  for (uint8_t i = 0; i < paramCount(); i++) {
+    TEST_ASSERT_EQUAL_INT(i, find(paramName(i)));
+  }
+  TEST_ASSERT_EQUAL_INT(-1, find("silent"));
+  TEST_ASSERT_EQUAL_INT(-1, find("silent_ms_"));
+  TEST_ASSERT_NULL(paramName(paramCount()));
+}
+
+static void test_set_in_range() {
+  int i = find("silent_ms");
+  TEST_ASSERT_EQUAL(PARAM_OK, paramSet(params, (uint8_t)i, 150));
+  TEST_ASSERT_EQUAL_UINT32(150, params.silentMs);
+  TEST_ASSERT_EQUAL_INT32(150, paramGet(params, (uint8_t)i));
+
+  TEST_ASSERT_EQUAL(PARAM_OK, paramSet(params, (uint8_t)find("deadband"), 12));
+  TEST_ASSERT_EQUAL_INT32(12, params.deadband);
+}
+
+static void test_out_of_range_leaves_value() {
+  TEST_ASSERT_EQUAL(PARAM_RANGE, paramSet(params, (uint8_t)find("silent_ms"), 0));
+  TEST_ASSERT_EQUAL(PARAM_RANGE, paramSet(params, (uint8_t)find("deadband"), -1));
+  TEST_ASSERT_EQUAL(PARAM_RANGE, paramSet(params, (uint8_t)find("status_ms"), 700000));
+  TEST_ASSERT_EQUAL(PARAM_UNKNOWN, paramSet(params, paramCount(), 1));
+  TEST_ASSERT_EQUAL_UINT32(SILENT_MS, params.silentMs);
+  TEST_ASSERT_EQUAL_INT32(DEADBAND, params.deadband);
+}
+
+// Cross rules are checked against the other values in effect, so order matters
+static void test_keepalive_must_stay_below_ttl() {
+  uint8_t keepalive = (uint8_t)find("keepalive_ms");
+  uint8_t ttl = (uint8_t)find("peer_ttl_ms");
+  TEST_ASSERT_EQUAL(PARAM_RANGE, paramSet(params, keepalive, PEER_TTL_MS));
+  TEST_ASSERT_EQUAL(PARAM_OK, paramSet(params, ttl, 10000));
+  TEST_ASSERT_EQUAL(PARAM_OK, paramSet(params, keepalive, 5000));
+  TEST_ASSERT_EQUAL(PARAM_RANGE, paramSet(params, ttl, 5000));
+  TEST_ASSERT_EQUAL_UINT32(10000, params.peerTtlMs);
+}
+
+static void test_blink_rules() {
+  TEST_ASSERT_EQUAL(PARAM_RANGE, paramSet(params, (uint8_t)find("blink_x2"), params.blinkX1));
+  TEST_ASSERT_EQUAL(PARAM_RANGE, paramSet(params, (uint8_t)find("blink_min_ms"), params.blinkMaxMs + 1));
+}
+
+static void test_record_round_trip() {
+  paramSet(params, (uint8_t)find("hysteresis"), 20);
+  ParamsRecord r;
+  paramsPack(params, r);
+
+  SwarmParams loaded;
+  paramsDefaults(loaded);
+  TEST_ASSERT_TRUE(paramsUnpack(r, loaded));
+  TEST_ASSERT_EQUAL_MEMORY(&params, &loaded, sizeof(params));
+}
+
+static void test_damaged_record_is_ignored() {
+  ParamsRecord r;
+  paramsPack(params, r);
+  SwarmParams out;
+  paramsDefaults(out);
+
+  ParamsRecord bad = r;
+  bad.params.silentMs ^= 1;
+  TEST_ASSERT_FALSE(paramsUnpack(bad, out));
+
+  bad = r;
+  bad.version++;
+  TEST_ASSERT_FALSE(paramsUnpack(bad, out));
+
+  memset(&bad, 0xFF, sizeof(bad));  // erased flash
+  TEST_ASSERT_FALSE(paramsUnpack(bad, out));
+  TEST_ASSERT_EQUAL_UINT32(SILENT_MS, out.silentMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_are_valid);
+  RUN_TEST(test_names_round_trip);
+  RUN_TEST(test_set_in_range);
+  RUN_TEST(test_out_of_range_leaves_value);
+  RUN_TEST(test_keepalive_must_stay_below_ttl);
+  RUN_TEST(test_blink_rules);
+  RUN_TEST(test_record_round_trip);
+  RUN_TEST(test_damaged_record_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "task_sched.h"
+
+// Each task advances the fake clock by its configured cost
+static Scheduler sched;
+static uint32_t clockUs = 0;
+static uint32_t fakeClockUs() {
+  return clockUs;
+}
+
+static uint32_t costUs[SCHED_MAX_TASKS];
+static char order[16];
+static uint8_t orderLen = 0;
+
+static void note(char c, uint8_t slot) {
+  if (orderLen < sizeof(order) - 1) order[orderLen++] = c;
+  clockUs += costUs[slot];
+}
+
+static void taskA() { note('a', 0); }
+static void taskB() { note('b', 1); }
+static void taskC() { note('c', 2); }
+static void taskD() { note('d', 3); }
+
+void setUp() {
+  schedInit(sched, 1000, 1, fakeClockUs);
+  clockUs = 0;
+  memset(costUs, 0, sizeof(costUs));
+  memset(order, 0, sizeof(order));
+  orderLen = 0;
+}
+
+void tearDown() {}
+
+static void pass(uint32_t nowMs) {
+  memset(order, 0, sizeof(order));
+  orderLen = 0;
+  schedRunPass(sched, nowMs);
+}
+
+static void test_runs_in_priority_order() {
+  schedAdd(sched, "d", taskD, 3, 0, 100);
+  schedAdd(sched, "b", taskB, 1, 0, 100);
+  schedAdd(sched, "a", taskA, 0, 0, 100);
+  schedAdd(sched, "c", taskC, 1, 0, 100);  // after b, same priority
+  pass(0);
+  TEST_ASSERT_EQUAL_STRING("abcd", order);
+  TEST_ASSERT_EQUAL_STRING("a", sched.task[0].name);
+}
+
+static void test_table_full() {
+  for (uint8_t i = 0; i < SCHED_MAX_TASKS; i++) {
+    TEST_ASSERT_TRUE(schedAdd(sched, "a", taskA, 0, 0, 100) >= 0);
+  }
+  TEST_ASSERT_EQUAL_INT(-1, schedAdd(sched, "a", taskA, 0, 0, 100));
+}
+
+static void test_periodic_task() {
+  schedAdd(sched, "a", taskA, 0, 0, 100);
+  schedAdd(sched, "b", taskB, 2, 20, 100);
+  pass(5);
+  TEST_ASSERT_EQUAL_STRING("ab", order);
+  pass(15);
+  TEST_ASSERT_EQUAL_STRING("a", order);
+  pass(25);
+  TEST_ASSERT_EQUAL_STRING("ab", order);
+  TEST_ASSERT_EQUAL_UINT32(2, sched.task[1].runs);
+}
+
+// Once the budget is gone, background work waits; critical work never does
+static void test_over_budget_defers_background() {
+  schedAdd(sched, "a", taskA, 0, 0, 2000);
+  schedAdd(sched, "b", taskB, 1, 0, 100);
+  schedAdd(sched, "c", taskC, 2, 0, 100);
+  costUs[0] = 1500;
+  pass(0);
+  TEST_ASSERT_EQUAL_STRING("ab", order);
+  TEST_ASSERT_EQUAL_UINT32(1, sched.task[2].deferrals);
+  TEST_ASSERT_EQUAL_UINT32(1, sched.passOverruns);
+
+  costUs[0] = 0;
+  pass(1);
+  TEST_ASSERT_EQUAL_STRING("abc", order);
+  TEST_ASSERT_EQUAL_UINT8(0, sched.task[2].deferredPasses);
+}
+
+static void test_deferral_is_bounded() {
+  schedAdd(sched, "a", taskA, 0, 0, 5000);
+  schedAdd(sched, "c", taskC, 2, 0, 100);
+  costUs[0] = 2000;
+  for (uint8_t i = 0; i < SCHED_MAX_DEFERRALS; i++) {
+    pass(i);
+    TEST_ASSERT_EQUAL_STRING("a", order);
+  }
+  pass(SCHED_MAX_DEFERRALS);
+  TEST_ASSERT_EQUAL_STRING("ac", order);
+  TEST_ASSERT_EQUAL_UINT32(SCHED_MAX_DEFERRALS, sched.task[1].deferrals);
+}
+
+static void test_overrun_and_worst_case() {
+  schedAdd(sched, "a", taskA, 0, 0, 300);
+  costUs[0] = 200;
+  pass(0);
+  costUs[0] = 400;
+  clockUs += 600;   // idle between passes
+  pass(1);
+  costUs[0] = 100;
+  pass(2);
+
+  const SchedTask& t = sched.task[0];
+  TEST_ASSERT_EQUAL_UINT32(3, t.runs);
+  TEST_ASSERT_EQUAL_UINT32(1, t.overruns);
+  TEST_ASSERT_EQUAL_UINT32(400, t.worstUs);
+  TEST_ASSERT_EQUAL_UINT32(800, t.worstGapUs);  // 200 run + 600 idle
+  TEST_ASSERT_EQUAL_UINT32(400, sched.worstPassUs);
+
+  schedResetWindow(sched);
+  TEST_ASSERT_EQUAL_UINT32(0, t.worstUs);
+  TEST_ASSERT_EQUAL_UINT32(0, t.worstGapUs);
+  TEST_ASSERT_EQUAL_UINT32(1, t.overruns);
+  pass(3);
+  TEST_ASSERT_EQUAL_UINT32(100, t.worstGapUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_runs_in_priority_order);
+  RUN_TEST(test_table_full);
+  RUN_TEST(test_periodic_task);
+  RUN_TEST(test_over_budget_defers_background);
+  RUN_TEST(test_deferral_is_bounded);
+  RUN_TEST(test_overrun_and_worst_case);
+  return UNITY_END();
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <queue>
+#include <vector>
+
+#include "swarm_election.h"
+#include "swarm_frame.h"
+
+// ===== Discrete-event swarm simulator =====
+// N virtual nodes run the real codec, node table and election code against a
+// lossy, jittery broadcast medium. The transmit schedulers are modelled after
+// loop() (SILENCE/JITTER holdoff or TDMA slots); ADC, deadband and the RPi
+// path are left out. Each node has its own clock offset, so sender
+// timestamps and TDMA slots are no more aligned than on real hardware.
+// Collisions are not modelled: a frame is either lost or delivered late.
+
+enum SimScheduler : uint8_t { SIM_SCHED_JITTER, SIM_SCHED_SLOTTED };
+
+struct SimConfig {
+  int          nodes      = 10;
+  SimScheduler sched      = SIM_SCHED_JITTER;
+  uint32_t     lossPct    = 0;      // per receiver, per frame
+  uint32_t     baseDelay  = 2;      // ms
+  uint32_t     jitterMs   = 0;      // extra uniform delay 0..jitterMs
+  int          noise      = 4;      // reading noise, +/- counts per turn
+  uint32_t     durationMs = 120000;
+  uint32_t     failAtMs   = 60000;  // master is powered off here; 0 = never
+  uint32_t     seed       = 1;
+
+  // Scheduler timing; defaults follow swarm_config.h
+  uint32_t silentMs   = SILENT_MS;
+  uint32_t txJitterMs = TX_JITTER_MS;
+  uint32_t slots      = 64;
+  uint32_t slotMs     = 8;
+};
+
+struct SimResult {
+  uint32_t convergeMs   = 0;  // boot to the last role change before a stable single MASTER
+  bool     converged    = false;
+  uint32_t failoverMs   = 0;  // master power-off to the last role change before re-convergence
+  bool     recovered    = false;
+  uint32_t flaps        = 0;  // role changes while the swarm was converged
+  double   flapsPerMin  = 0;
+  int      finalMasters = 0;
+  int      rankShortfall = 0;  // best live base reading minus the final master's
+  uint64_t framesSent   = 0;
+  uint64_t framesLost   = 0;
+};
+
+class SwarmSim {
+ public:
+  explicit SwarmSim(const SimConfig& cfg) : cfg_(cfg), rng_(cfg.seed ? cfg.seed : 1) {
+    nodes_.resize(cfg.nodes);
+    for (int i = 0; i < cfg.nodes; i++) {
+      Node& n = nodes_[i];
+      nodeTableInit(n.table, nullptr);
+      n.election = ElectionState();
+      n.id = (uint16_t)(10 + i);
+      n.key = 192u | (168u << 8) | ((uint32_t)n.id << 24);
+      n.clockOffset = rand32();
+      n.base = (int)(rand32() % 1025);
+      n.bootMs = rand32() % 1000;
+      push(n.bootMs, EV_WAKE, i);
+    }
+  }
+
+  SimResult run() {
+    lastChangeMs_ = 1000;
+    while (!queue_.empty()) {
+      Event ev = queue_.top();
+      queue_.pop();
+      if (ev.t > cfg_.durationMs) break;
+      now_ = ev.t;
+
+      if (cfg_.failAtMs && !failed_ && now_ >= cfg_.failAtMs) failMaster();
+
+      if (ev.type == EV_WAKE) {
+        wake(ev.node, ev.gen);
+      } else {
+        deliver(ev);
+      }
+      checkConvergence();
+    }
+
+    result_.finalMasters = masterCount();
+    int best = -1, master = -1;
+    for (int i = 0; i < cfg_.nodes; i++) {
+      const Node& n = nodes_[i];
+      if (!n.alive) continue;
+      if (best < 0 || n.base > nodes_[best].base) best = i;
+      if (n.isMaster) master = i;
+    }
+    if (best >= 0 && master >= 0) result_.rankShortfall = nodes_[best].base - nodes_[master].base;
+
+    double stableMin = stableMs_ / 60000.0;
+    result_.flapsPerMin = stableMin > 0 ? result_.flaps / stableMin : 0;
+    return result_;
+  }
+
+ private:
+  enum EventType : uint8_t { EV_WAKE, EV_DELIVER };
+
+  struct Event {
+    uint32_t t;
+    uint32_t order;  // FIFO among equal times, keeps runs deterministic
+    EventType type;
+    int node;
+    uint32_t gen;
+    uint32_t srcKey;
+    uint8_t frame[SWARM_FRAME_LEN];
+  };
+
+  struct Later {
+    bool operator()(const Event& a, const Event& b) const {
+      return a.t != b.t ? a.t > b.t : a.order > b.order;
+    }
+  };
+
+  struct Node {
+    NodeTable table;
+    ElectionState election;
+    uint16_t id;
+    uint32_t key;
+    uint32_t clockOffset;
+    uint32_t bootMs;
+    int base;
+    bool alive = true;
+    bool isMaster = true;
+    int advertised = -1;
+    uint16_t txSeq = 0;
+    uint32_t lastRxMs = 0;  // local clock
+    uint32_t holdoffMs = 0;
+    uint32_t lastFrame = 0xFFFFFFFF;
+    uint32_t wakeGen = 0;
+  };
+
+  uint32_t rand32() {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+  }
+
+  uint32_t local(const Node& n) const { return now_ + n.clockOffset; }
+
+  void push(uint32_t t, EventType type, int node, uint32_t gen = 0) {
+    Event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.t = t;
+    ev.order = order_++;
+    ev.type = type;
+    ev.node = node;
+    ev.gen = gen;
+    queue_.push(ev);
+  }
+
+  void redrawHoldoff(Node& n) {
+    n.holdoffMs = cfg_.silentMs + rand32() % (cfg_.txJitterMs + 1);
+  }
+
+  // Next time loop() would find txDue() true, in simulator time
+  uint32_t nextTurn(const Node& n) const {
+    uint32_t t = local(n);
+    if (cfg_.sched == SIM_SCHED_JITTER) {
+      uint32_t due = n.lastRxMs + n.holdoffMs + 1;
+      return now_ + ((int32_t)(due - t) > 0 ? due - t : 0);
+    }
+    uint32_t frameMs = cfg_.slots * cfg_.slotMs;
+    uint32_t slotStart = ((uint32_t)n.id % cfg_.slots) * cfg_.slotMs;
+    uint32_t frame = t / frameMs;
+    if (frame == n.lastFrame || t % frameMs >= slotStart + cfg_.slotMs) frame++;
+    uint32_t start = frame * frameMs + slotStart;
+    return now_ + (start > t ? start - t : 0);
+  }
+
+  void scheduleWake(int i) {
+    Node& n = nodes_[i];
+    push(nextTurn(n), EV_WAKE, i, ++n.wakeGen);
+  }
+
+  void wake(int i, uint32_t gen) {
+    Node& n = nodes_[i];
+    if (!n.alive) return;
+    if (gen == 0) {
+      // Boot: firmware sets lastReceivedTime in setup()
+      n.lastRxMs = local(n);
+      redrawHoldoff(n);
+      scheduleWake(i);
+      return;
+    }
+    if (gen != n.wakeGen) return;  // superseded by a later peer packet
+
+    nodeTableSweep(n.table, local(n));
+    transmit(i);
+
+    n.lastRxMs = local(n);
+    n.lastFrame = local(n) / (cfg_.slots * cfg_.slotMs);
+    redrawHoldoff(n);
+
+    bool role = electMaster(n.table, n.election, {n.advertised, n.id, n.key}, n.isMaster, local(n));
+    if (role != n.isMaster) {
+      n.isMaster = role;
+      roleChanged();
+    }
+    scheduleWake(i);
+  }
+
+  void transmit(int i) {
+    Node& n = nodes_[i];
+    int value = n.base + (int)(rand32() % (2 * cfg_.noise + 1)) - cfg_.noise;
+    if (value < 0) value = 0;
+    if (value > 1024) value = 1024;
+
+    SwarmFrame f = {};
+    f.type        = SWARM_TYPE_READING;
+    f.flags       = n.isMaster ? SWARM_FLAG_MASTER : 0;
+    f.nodeId      = n.id;
+    f.reading     = (uint16_t)value;
+    f.seq         = ++n.txSeq;
+    f.timestampMs = local(n);
+    n.advertised  = value;
+
+    Event ev;
+    memset(&ev, 0, sizeof(ev));
+    encodeSwarmFrame(ev.frame, f);
+    ev.type = EV_DELIVER;
+    ev.srcKey = n.key;
+    for (int r = 0; r < cfg_.nodes; r++) {
+      if (r == i) continue;
+      result_.framesSent++;
+      if (rand32() % 100 < cfg_.lossPct) {
+        result_.framesLost++;
+        continue;
+      }
+      ev.t = now_ + cfg_.baseDelay + (cfg_.jitterMs ? rand32() % (cfg_.jitterMs + 1) : 0);
+      ev.order = order_++;
+      ev.node = r;
+      queue_.push(ev);
+    }
+  }
+
+  void deliver(const Event& ev) {
+    Node& n = nodes_[ev.node];
+    if (!n.alive || now_ < n.bootMs) return;
+
+    SwarmFrame f;
+    if (!decodeSwarmFrame(ev.frame, SWARM_FRAME_LEN, &f)) return;
+    uint32_t t = local(n);
+    nodeTableSweep(n.table, t);
+    if (!nodeTableStore(n.table, ev.srcKey, f, false, t)) return;
+
+    if (cfg_.sched == SIM_SCHED_JITTER) {
+      // txOnPeerPacket(): a peer won the contention, keep our unused backoff
+      uint32_t waited = t - n.lastRxMs;
+      if (waited > cfg_.silentMs) {
+        uint32_t used = waited - cfg_.silentMs;
+        n.holdoffMs = used < n.holdoffMs - cfg_.silentMs ? n.holdoffMs - used : cfg_.silentMs;
+      }
+      n.lastRxMs = t;
+      scheduleWake(ev.node);
+    } else {
+      n.lastRxMs = t;
+    }
+  }
+
+  void failMaster() {
+    failed_ = true;
+    for (Node& n : nodes_) {
+      if (n.alive && n.isMaster) {
+        n.alive = false;
+        n.isMaster = false;
+        break;
+      }
+    }
+    phase_ = PHASE_FAILOVER;
+    lastChangeMs_ = now_;
+  }
+
+  int masterCount() const {
+    int c = 0;
+    for (const Node& n : nodes_) c += (n.alive && n.isMaster) ? 1 : 0;
+    return c;
+  }
+
+  void roleChanged() {
+    if (phase_ == PHASE_STABLE) {
+      result_.flaps++;
+      stableMs_ += now_ - stableSinceMs_;
+      stableSinceMs_ = now_;
+    }
+    lastChangeMs_ = now_;
+  }
+
+  void checkConvergence() {
+    if (phase_ == PHASE_STABLE) {
+      stableMs_ += now_ - stableSinceMs_;
+      stableSinceMs_ = now_;
+      return;
+    }
+    if (now_ - lastChangeMs_ < CONVERGE_STABLE_MS || masterCount() != 1) return;
+
+    if (phase_ == PHASE_BOOT) {
+      result_.converged = true;
+      result_.convergeMs = lastChangeMs_;
+    } else {
+      result_.recovered = true;
+      result_.failoverMs = lastChangeMs_ - cfg_.failAtMs;
+    }
+    phase_ = PHASE_STABLE;
+    stableSinceMs_ = now_;
+  }
+
+  enum Phase : uint8_t { PHASE_BOOT, PHASE_STABLE, PHASE_FAILOVER };
+
+  SimConfig cfg_;
+  uint32_t rng_;
+  std::vector<Node> nodes_;
+  std::priority_queue<Event, std::vector<Event>, Later> queue_;
+  uint32_t order_ = 0;
+  uint32_t now_ = 0;
+  bool failed_ = false;
+  Phase phase_ = PHASE_BOOT;
+  uint32_t lastChangeMs_ = 0;
+  uint32_t stableSinceMs_ = 0;
+  uint64_t stableMs_ = 0;
+  SimResult result_;
+};
+
+inline SimResult runSimulation(const SimConfig& cfg) {
+  SwarmSim sim(cfg);
+  return sim.run();
+}
@@ -18,10 +18,37 @@ const WHITE_LED_PIN: u32 = 18;
 const RGB_LED_PINS: [u32; 3] = [17, 22, 27];
 
 // ===== UDP / Protocol =====
-const PORT: u16 = 4210;
+// Nodes listen on the swarm port. We bind the RPi port, which is the same
+// one unless the firmware was built with -DSWARM_RPI_PORT; set the
+// SWARM_UDP_PORT / SWARM_RPI_PORT environment variables to match the build.
+const DEFAULT_PORT: u16 = 4210;
+// ESPs learn our address from this beacon and unicast master reports to us
+const BEACON_INTERVAL_MS: u64 = 2000;
 const RPI_START: &str = "+++";
 const RPI_END: &str = "***";
 
+// Node sample history is pulled one node at a time, round-robin
+const HISTORY_POLL_MS: u64 = 2000;
+const HISTORY_FILE: &str = "history_readings.txt";
+
+// ===== Health metrics =====
+// Every node is scraped with one broadcast; rates come from consecutive replies
+const METRICS_SCRAPE_MS: u64 = 10_000;
+const METRICS_ALERT_RX_GAP_US: u64 = 50_000;
+const METRICS_ALERT_FRAG_PCT: u32 = 50;
+
+// ===== OTA rollout =====
+// One node at a time, the master last, so the swarm keeps a master and
+// keeps reporting. A node gets this long to come back on the new image.
+const OTA_NODE_TIMEOUT_MS: u64 = 180_000;
+// OTA_UPDATE is signed with the key the firmware was built with
+// (SWARM_OTA_KEY); override this default with the same environment variable
+const OTA_DEFAULT_KEY: &str = "swarm-ota";
+// The firmware takes the whole command in one 255-byte receive buffer, so
+// these match its otaVersion and OTA_URL_MAX limits
+const OTA_VERSION_MAX: usize = 15;
+const OTA_URL_MAX: usize = 150;
+
 // ===== Blink mapping (same mapping as your ESP) =====
 const X1: f64 = 24.0;
 const Y1: f64 = 2010.0 / 1000.0;
@@ -98,6 +125,258 @@ impl SharedState {
     }
 }
 
+// Where to resume each node's history; nodes are learned from reports.
+// Only the UDP thread touches it, so it lives outside SharedState.
+struct HistoryPoller {
+    next_seq: HashMap<String, u64>,
+    order: Vec<String>,
+    cursor: usize,
+    last_poll: Option<Instant>,
+}
+
+impl HistoryPoller {
+    fn new() -> Self {
+        Self {
+            next_seq: HashMap::new(),
+            order: Vec::new(),
+            cursor: 0,
+            last_poll: None,
+        }
+    }
+
+    fn note_node(&mut self, swarm_id: &str) {
+        if !self.next_seq.contains_key(swarm_id) {
+            self.next_seq.insert(swarm_id.to_string(), 0);
+            self.order.push(swarm_id.to_string());
+        }
+    }
+
+    fn resume_at(&mut self, swarm_id: &str, next: u64) {
+        self.note_node(swarm_id);
+        self.next_seq.insert(swarm_id.to_string(), next);
+    }
+
+    // The next request to broadcast, if one is due
+    fn next_request(&mut self) -> Option<String> {
+        if self.order.is_empty()
+            || self
+                .last_poll
+                .map_or(false, |t| t.elapsed() < Duration::from_millis(HISTORY_POLL_MS))
+        {
+            return None;
+        }
+        self.last_poll = Some(Instant::now());
+        let id = &self.order[self.cursor % self.order.len()];
+        self.cursor = self.cursor.wrapping_add(1);
+        let from = self.next_seq.get(id).copied().unwrap_or(0);
+        Some(format!("{RPI_START}HISTORY_REQUESTED,{id},{from}{RPI_END}"))
+    }
+}
+
+// +++Metrics,...***; counters run from the node's boot and wrap at 32 bits
+#[derive(Clone, Default)]
+struct NodeMetrics {
+    master: bool,
+    uptime_ms: u64,
+    loops: u64,
+    rx: u64,
+    tx: u64,
+    rx_drop: u64,
+    rx_lost: u64,
+    heap: u64,
+    heap_max_block: u64,
+    heap_frag_pct: u32,
+    rssi: i32,
+    role_changes: u64,
+    failovers: u64,
+    failover_ms: u64,
+    rx_gap_us: u64,
+    sched_overruns: u64,
+    boot_id: u64,
+}
+
+// Last reply and loop rate per node
+struct MetricsCollector {
+    last: HashMap<String, (NodeMetrics, f64)>,
+    last_scrape: Option<Instant>,
+}
+
+impl MetricsCollector {
+    fn new() -> Self {
+        Self { last: HashMap::new(), last_scrape: None }
+    }
+
+    fn next_request(&mut self) -> Option<String> {
+        if self
+            .last_scrape
+            .map_or(false, |t| t.elapsed() < Duration::from_millis(METRICS_SCRAPE_MS))
+        {
+            return None;
+        }
+        self.last_scrape = Some(Instant::now());
+        Some(format!("{RPI_START}METRICS_REQUESTED{RPI_END}"))
+    }
+
+    // Prints one METRICS line, plus an ALERT line per regression. Rates cover
+    // the time since the previous reply, or since boot for the first one.
+    // A new boot_id is a reboot; uptime alone would also drop at the 49-day
+    // millis() wrap.
+    fn on_metrics(&mut self, ts_ms: u128, id: &str, m: NodeMetrics) {
+        let prev = self.last.get(id).cloned();
+        let rebooted = prev.as_ref().map_or(false, |(p, _)| m.boot_id != p.boot_id);
+        let (base, prev_hz) = match &prev {
+            Some((p, hz)) if !rebooted => (p.clone(), Some(*hz)),
+            _ => (NodeMetrics::default(), None),
+        };
+        let delta = |now: u64, then: u64| (now as u32).wrapping_sub(then as u32) as u64;
+        let dt_s = delta(m.uptime_ms, base.uptime_ms).max(1) as f64 / 1000.0;
+        let rate = |now: u64, then: u64| delta(now, then) as f64 / dt_s;
+        let loop_hz = rate(m.loops, base.loops);
+
+        println!(
+            "[{ts_ms}] METRICS id={id} role={} up={}s loop_hz={loop_hz:.0} rx={:.1}/s tx={:.1}/s drop=+{} lost=+{} \
+             heap={} max_block={} frag={}% rssi={}dBm flips={} failovers={} failover={}ms rx_gap={}us overruns=+{}",
+            if m.master { "MASTER" } else { "SLAVE" },
+            m.uptime_ms / 1000,
+            rate(m.rx, base.rx),
+            rate(m.tx, base.tx),
+            delta(m.rx_drop, base.rx_drop),
+            delta(m.rx_lost, base.rx_lost),
+            m.heap,
+            m.heap_max_block,
+            m.heap_frag_pct,
+            m.rssi,
+            m.role_changes,
+            m.failovers,
+            m.failover_ms,
+            m.rx_gap_us,
+            delta(m.sched_overruns, base.sched_overruns),
+        );
+
+        if rebooted {
+            println!("[{ts_ms}] ALERT id={id} reboot uptime={}ms", m.uptime_ms);
+        }
+        if let Some(hz) = prev_hz {
+            if loop_hz < hz / 2.0 {
+                println!("[{ts_ms}] ALERT id={id} loop_rate {hz:.0} -> {loop_hz:.0} Hz");
+            }
+        }
+        if m.rx_gap_us > METRICS_ALERT_RX_GAP_US {
+            println!("[{ts_ms}] ALERT id={id} rx_gap={}us limit={METRICS_ALERT_RX_GAP_US}us", m.rx_gap_us);
+        }
+        if m.heap_frag_pct >= METRICS_ALERT_FRAG_PCT {
+            println!("[{ts_ms}] ALERT id={id} heap_frag={}% limit={METRICS_ALERT_FRAG_PCT}%", m.heap_frag_pct);
+        }
+        self.last.insert(id.to_string(), (m, loop_hz));
+    }
+}
+
+struct OtaJob {
+    version: String,
+    md5: String,
+    url: String,
+}
+
+struct OtaRollout {
+    key: String,
+    job: Option<OtaJob>,
+    queue: Vec<String>,
+    current: Option<(String, Instant)>,
+    updated: usize,
+    skipped: usize,
+    failed: usize,
+}
+
+impl OtaRollout {
+    fn new(key: String) -> Self {
+        Self { key, job: None, queue: Vec::new(), current: None, updated: 0, skipped: 0, failed: 0 }
+    }
+
+    fn start(&mut self, job: OtaJob, nodes: &[String]) {
+        self.queue = nodes.to_vec();
+        self.current = None;
+        self.updated = 0;
+        self.skipped = 0;
+        self.failed = 0;
+        self.job = Some(job);
+    }
+
+    // The next OTA_UPDATE to send, if the previous node is done or timed out.
+    // The current master is put back in the queue while other nodes remain.
+    fn next_request(&mut self, master: Option<&str>) -> Option<String> {
+        let job = self.job.as_ref()?;
+        if let Some((id, since)) = &self.current {
+            if since.elapsed() < Duration::from_millis(OTA_NODE_TIMEOUT_MS) {
+                return None;
+            }
+            println!("OTA id={id} timed out");
+            self.failed += 1;
+            self.current = None;
+        }
+        if self.queue.is_empty() {
+            println!(
+                "OTA rollout {} finished: updated={} current={} failed={}",
+                job.version, self.updated, self.skipped, self.failed
+            );
+            self.job = None;
+            return None;
+        }
+        let mut idx = 0;
+        if self.queue.len() > 1 && master == Some(self.queue[0].as_str()) {
+            idx = 1;
+        }
+        let id = self.queue.remove(idx);
+        let fields = format!("{id},{},{},{}", job.version, job.md5, job.url);
+        let token = hmac_md5_hex(self.key.as_bytes(), fields.as_bytes());
+        let cmd = format!("{RPI_START}OTA_UPDATE,{fields},{token}{RPI_END}");
+        self.current = Some((id, Instant::now()));
+        Some(cmd)
+    }
+
+    fn is_current(&self, id: &str) -> bool {
+        self.current.as_ref().map_or(false, |(c, _)| c == id)
+    }
+
+    // downloading/verified keep waiting for OtaDone; anything else ends the turn
+    fn on_ack(&mut self, id: &str, status: &str) {
+        if !self.is_current(id) {
+            return;
+        }
+        match status {
+            "queued" | "downloading" | "verified" => {}
+            "current" => {
+                self.skipped += 1;
+                self.current = None;
+            }
+            // The image itself is bad; every other node would reject it too
+            "badmd5" => {
+                println!("OTA rollout stopped: image failed verification on id={id}");
+                self.failed += 1;
+                self.queue.clear();
+                self.current = None;
+            }
+            // So is the key, unless the nodes were built with different ones
+            "denied" => {
+                println!("OTA rollout stopped: id={id} rejected the signature; check SWARM_OTA_KEY");
+                self.failed += 1;
+                self.queue.clear();
+                self.current = None;
+            }
+            _ => {
+                self.failed += 1;
+                self.current = None;
+            }
+        }
+    }
+
+    fn on_done(&mut self, id: &str) {
+        if self.is_current(id) {
+            self.updated += 1;
+            self.current = None;
+        }
+    }
+}
+
 enum GpioCmd {
     AllRgbOff,
     BlinkRgb { idx: usize, on: bool },
@@ -160,8 +439,13 @@ fn parse_message(payload: &str) -> Option<(String, i32)> {
     }
     let inner = &payload[RPI_START.len()..payload.len() - RPI_END.len()];
 
-    // ignore reset packets
-    if inner == "RESET_REQUESTED" {
+    // ignore our own reset/beacon/time/tuning packets
+    if inner == "RESET_REQUESTED"
+        || inner == "RPI_BEACON"
+        || inner.starts_with("RPI_TIME,")
+        || inner.starts_with("GET_PARAMS,")
+        || inner.starts_with("DEFAULT_PARAMS,")
+    {
         return None;
     }
 
@@ -182,6 +466,264 @@ fn parse_message(payload: &str) -> Option<(String, i32)> {
     }
 }
 
+// Master swarm snapshot:
+// +++Swarm,<master_id>,<id>:<reading>:<age_ms>;<id>:<reading>:<age_ms>...***
+struct SwarmEntry {
+    swarm_id: String,
+    reading: i32,
+    age_ms: u32,
+}
+
+fn parse_snapshot(payload: &str) -> Option<(String, Vec<SwarmEntry>)> {
+    let inner = payload.strip_prefix(RPI_START)?.strip_suffix(RPI_END)?;
+    let rest = inner.strip_prefix("Swarm,")?;
+    let (master_id, list) = rest.split_once(',')?;
+
+    let mut entries = Vec::new();
+    for item in list.split(';') {
+        let mut fields = item.split(':');
+        let (Some(id), Some(reading), Some(age), None) =
+            (fields.next(), fields.next(), fields.next(), fields.next())
+        else {
+            return None;
+        };
+        entries.push(SwarmEntry {
+            swarm_id: id.to_string(),
+            reading: reading.parse().ok()?,
+            age_ms: age.parse().ok()?,
+        });
+    }
+    Some((master_id.to_string(), entries))
+}
+
+// Node history, sent in reply to +++HISTORY_REQUESTED,<id>,<from_seq>***:
+// +++History,<id>,<seq>,<t_ms>,<period_ms>,<value>,<delta>,<delta>...***
+// followed by +++HistoryEnd,<id>,<next_seq>***. t_ms is the node's own clock.
+struct HistoryChunk {
+    swarm_id: String,
+    first_seq: u64,
+    first_ms: u64,
+    period_ms: u64,
+    values: Vec<i32>,
+}
+
+fn parse_history(payload: &str) -> Option<HistoryChunk> {
+    let inner = payload.strip_prefix(RPI_START)?.strip_suffix(RPI_END)?;
+    let rest = inner.strip_prefix("History,")?;
+    let mut fields = rest.split(',');
+    let swarm_id = fields.next()?.to_string();
+    let first_seq = fields.next()?.parse().ok()?;
+    let first_ms = fields.next()?.parse().ok()?;
+    let period_ms = fields.next()?.parse().ok()?;
+
+    let mut value: i32 = fields.next()?.parse().ok()?;
+    let mut values = vec![value];
+    for delta in fields {
+        value += delta.parse::<i32>().ok()?;
+        values.push(value);
+    }
+    Some(HistoryChunk {
+        swarm_id,
+        first_seq,
+        first_ms,
+        period_ms,
+        values,
+    })
+}
+
+fn parse_history_end(payload: &str) -> Option<(String, u64)> {
+    let inner = payload.strip_prefix(RPI_START)?.strip_suffix(RPI_END)?;
+    let (id, next) = inner.strip_prefix("HistoryEnd,")?.split_once(',')?;
+    Some((id.to_string(), next.parse().ok()?))
+}
+
+// Console tuning commands, <target> is a swarm ID or * for every node:
+//   set <target> <name> <value>   get <target>   defaults <target>
+fn parse_tune_command(line: &str) -> Option<String> {
+    let words: Vec<&str> = line.split_whitespace().collect();
+    let cmd = match words.as_slice() {
+        ["set", target, name, value] => {
+            value.parse::<i32>().ok()?;
+            format!("SET_PARAM,{target},{name},{value}")
+        }
+        ["get", target] => format!("GET_PARAMS,{target}"),
+        ["defaults", target] => format!("DEFAULT_PARAMS,{target}"),
+        _ => return None,
+    };
+    Some(format!("{RPI_START}{cmd}{RPI_END}"))
+}
+
+// ===== OTA signature =====
+// HMAC-MD5 (RFC 2104), matching otaAuthToken() in the firmware, which has
+// MD5 from the ESP8266 core
+fn md5(data: &[u8]) -> [u8; 16] {
+    const S: [u32; 16] = [7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21];
+    let k: Vec<u32> = (0..64).map(|i| ((i as f64 + 1.0).sin().abs() * 4_294_967_296.0) as u32).collect();
+
+    let mut msg = data.to_vec();
+    msg.push(0x80);
+    while msg.len() % 64 != 56 {
+        msg.push(0);
+    }
+    msg.extend_from_slice(&((data.len() as u64).wrapping_mul(8)).to_le_bytes());
+
+    let mut h: [u32; 4] = [0x6745_2301, 0xefcd_ab89, 0x98ba_dcfe, 0x1032_5476];
+    for chunk in msg.chunks(64) {
+        let m: Vec<u32> = chunk.chunks(4).map(|w| u32::from_le_bytes([w[0], w[1], w[2], w[3]])).collect();
+        let [mut a, mut b, mut c, mut d] = h;
+        for i in 0..64 {
+            let (f, g) = match i / 16 {
+                0 => ((b & c) | (!b & d), i),
+                1 => ((d & b) | (!d & c), (5 * i + 1) % 16),
+                2 => (b ^ c ^ d, (3 * i + 5) % 16),
+                _ => (c ^ (b | !d), (7 * i) % 16),
+            };
+            let f = f.wrapping_add(a).wrapping_add(k[i]).wrapping_add(m[g]);
+            a = d;
+            d = c;
+            c = b;
+            b = b.wrapping_add(f.rotate_left(S[(i / 16) * 4 + i % 4]));
+        }
+        for (x, y) in h.iter_mut().zip([a, b, c, d]) {
+            *x = x.wrapping_add(y);
+        }
+    }
+
+    let mut out = [0u8; 16];
+    for (i, x) in h.iter().enumerate() {
+        out[i * 4..i * 4 + 4].copy_from_slice(&x.to_le_bytes());
+    }
+    out
+}
+
+fn hmac_md5_hex(key: &[u8], msg: &[u8]) -> String {
+    let mut block = [0u8; 64];
+    if key.len() > 64 {
+        block[..16].copy_from_slice(&md5(key));
+    } else {
+        block[..key.len()].copy_from_slice(key);
+    }
+    let mut inner: Vec<u8> = block.iter().map(|b| b ^ 0x36).collect();
+    inner.extend_from_slice(msg);
+    let mut outer: Vec<u8> = block.iter().map(|b| b ^ 0x5c).collect();
+    outer.extend_from_slice(&md5(&inner));
+    md5(&outer).iter().map(|b| format!("{b:02x}")).collect()
+}
+
+// ota <version> <md5> <url>; None if the line is not an ota command, an
+// error if it is one no node would accept
+fn parse_ota_command(line: &str) -> Option<Result<OtaJob, String>> {
+    let words: Vec<&str> = line.split_whitespace().collect();
+    if words.first() != Some(&"ota") {
+        return None;
+    }
+    let ["ota", version, md5, url] = words.as_slice() else {
+        return Some(Err("usage: ota <version> <md5> <url>".to_string()));
+    };
+    if version.len() > OTA_VERSION_MAX {
+        return Some(Err(format!("OTA version is {} chars, nodes take at most {OTA_VERSION_MAX}", version.len())));
+    }
+    if md5.len() != 32 {
+        return Some(Err("OTA md5 must be 32 hex chars".to_string()));
+    }
+    if !url.starts_with("http://") {
+        return Some(Err("OTA url must start with http://".to_string()));
+    }
+    if url.len() > OTA_URL_MAX {
+        return Some(Err(format!("OTA url is {} chars, nodes take at most {OTA_URL_MAX}", url.len())));
+    }
+    Some(Ok(OtaJob { version: version.to_string(), md5: md5.to_string(), url: url.to_string() }))
+}
+
+// +++OtaAck,<id>,<status>,<running_version>***
+fn parse_ota_ack(payload: &str) -> Option<(String, String, String)> {
+    let inner = payload.strip_prefix(RPI_START)?.strip_suffix(RPI_END)?;
+    let parts: Vec<&str> = inner.strip_prefix("OtaAck,")?.split(',').collect();
+    let [id, status, version] = parts.as_slice() else {
+        return None;
+    };
+    Some((id.to_string(), status.to_string(), version.to_string()))
+}
+
+// +++OtaDone,<id>,<version>,<downtime_ms>,<swarm|local>***
+fn parse_ota_done(payload: &str) -> Option<(String, String, u64, String)> {
+    let inner = payload.strip_prefix(RPI_START)?.strip_suffix(RPI_END)?;
+    let parts: Vec<&str> = inner.strip_prefix("OtaDone,")?.split(',').collect();
+    let [id, version, downtime, clock] = parts.as_slice() else {
+        return None;
+    };
+    Some((id.to_string(), version.to_string(), downtime.parse().ok()?, clock.to_string()))
+}
+
+// +++Metrics,<id>,<master>,<uptime_ms>,<loops>,<rx>,<tx>,<rx_drop>,<rx_lost>,<heap>,<heap_max_block>,
+//   <heap_frag_pct>,<rssi>,<role_changes>,<failovers>,<failover_ms>,<rx_gap_us>,<sched_overruns>,<boot_id>***
+fn parse_metrics(payload: &str) -> Option<(String, NodeMetrics)> {
+    let inner = payload.strip_prefix(RPI_START)?.strip_suffix(RPI_END)?;
+    let parts: Vec<&str> = inner.strip_prefix("Metrics,")?.split(',').collect();
+    let [id, master, uptime, loops, rx, tx, rx_drop, rx_lost, heap, max_block, frag, rssi, flips, failovers, failover_ms, rx_gap, overruns, boot_id] =
+        parts.as_slice()
+    else {
+        return None;
+    };
+    Some((
+        id.to_string(),
+        NodeMetrics {
+            master: *master == "1",
+            uptime_ms: uptime.parse().ok()?,
+            loops: loops.parse().ok()?,
+            rx: rx.parse().ok()?,
+            tx: tx.parse().ok()?,
+            rx_drop: rx_drop.parse().ok()?,
+            rx_lost: rx_lost.parse().ok()?,
+            heap: heap.parse().ok()?,
+            heap_max_block: max_block.parse().ok()?,
+            heap_frag_pct: frag.parse().ok()?,
+            rssi: rssi.parse().ok()?,
+            role_changes: flips.parse().ok()?,
+            failovers: failovers.parse().ok()?,
+            failover_ms: failover_ms.parse().ok()?,
+            rx_gap_us: rx_gap.parse().ok()?,
+            sched_overruns: overruns.parse().ok()?,
+            boot_id: boot_id.parse().ok()?,
+        },
+    ))
+}
+
+// +++ParamAck,<id>,<name>,<value>,<result>*** and +++Params,<id>,<name>=<value>,...***
+fn parse_param_reply(payload: &str) -> Option<String> {
+    let inner = payload.strip_prefix(RPI_START)?.strip_suffix(RPI_END)?;
+    if let Some(ack) = inner.strip_prefix("ParamAck,") {
+        let parts: Vec<&str> = ack.split(',').collect();
+        let [id, name, value, result] = parts.as_slice() else {
+            return None;
+        };
+        return Some(format!("PARAM_ACK id={id} {name}={value} result={result}"));
+    }
+    let (id, values) = inner.strip_prefix("Params,")?.split_once(',')?;
+    Some(format!("PARAMS id={id} {}", values.replace(',', " ")))
+}
+
+fn append_history(chunk: &HistoryChunk) -> Result<()> {
+    let mut f = OpenOptions::new()
+        .create(true)
+        .append(true)
+        .open(HISTORY_FILE)
+        .with_context(|| format!("Failed to open {HISTORY_FILE} for append"))?;
+    for (i, value) in chunk.values.iter().enumerate() {
+        let i = i as u64;
+        writeln!(
+            f,
+            "Swarm ID {} seq={} t={}ms: {}",
+            chunk.swarm_id,
+            chunk.first_seq + i,
+            chunk.first_ms + i * chunk.period_ms,
+            value
+        )
+        .context("Failed to write history line")?;
+    }
+    Ok(())
+}
+
 fn blink_interval_seconds(reading: i32) -> f64 {
     let slope = (Y2 - Y1) / (X2 - X1);
     let intercept = Y1 - slope * X1;
@@ -194,10 +736,19 @@ fn blink_interval_seconds(reading: i32) -> f64 {
     seconds
 }
 
+fn port_from_env(name: &str, default: u16) -> Result<u16> {
+    match std::env::var(name) {
+        Ok(v) => v.trim().parse().with_context(|| format!("{name}={v} is not a UDP port")),
+        Err(_) => Ok(default),
+    }
+}
+
 fn main() -> Result<()> {
     // ===== UDP init =====
-    let sock = UdpSocket::bind(SocketAddrV4::new(Ipv4Addr::UNSPECIFIED, PORT))
-        .with_context(|| format!("Failed to bind UDP port {PORT}"))?;
+    let swarm_port = port_from_env("SWARM_UDP_PORT", DEFAULT_PORT)?;
+    let rpi_port = port_from_env("SWARM_RPI_PORT", swarm_port)?;
+    let sock = UdpSocket::bind(SocketAddrV4::new(Ipv4Addr::UNSPECIFIED, rpi_port))
+        .with_context(|| format!("Failed to bind UDP port {rpi_port}"))?;
     sock.set_broadcast(true).context("Failed to enable broadcast")?;
     sock.set_read_timeout(Some(Duration::from_millis(100)))
         .context("Failed to set read timeout")?;
@@ -267,7 +818,7 @@ fn main() -> Result<()> {
 
                 // broadcast reset
                 let msg = format!("{RPI_START}RESET_REQUESTED{RPI_END}");
-                let bcast = SocketAddrV4::new(Ipv4Addr::new(255, 255, 255, 255), PORT);
+                let bcast = SocketAddrV4::new(Ipv4Addr::new(255, 255, 255, 255), swarm_port);
                 let _ = sock_send.send_to(msg.as_bytes(), bcast);
 
                 // clear log + reset state
@@ -294,13 +845,57 @@ fn main() -> Result<()> {
         }
     });
 
+    // ===== Console: tuning goes straight out, OTA rollouts to the main loop =====
+    let sock_tune = sock.try_clone().context("Failed to clone UDP socket")?;
+    let (ota_tx, ota_rx) = mpsc::channel::<OtaJob>();
+    let _console_thread = thread::spawn(move || {
+        let bcast = SocketAddrV4::new(Ipv4Addr::new(255, 255, 255, 255), swarm_port);
+        for line in std::io::stdin().lines() {
+            let Ok(line) = line else { break };
+            match parse_ota_command(&line) {
+                Some(Ok(job)) => {
+                    let _ = ota_tx.send(job);
+                    continue;
+                }
+                Some(Err(e)) => {
+                    println!("{e}");
+                    continue;
+                }
+                None => {}
+            }
+            match parse_tune_command(&line) {
+                Some(cmd) => {
+                    let _ = sock_tune.send_to(cmd.as_bytes(), bcast);
+                }
+                None if line.trim().is_empty() => {}
+                None => println!(
+                    "usage: set <id|*> <name> <value> | get <id|*> | defaults <id|*> | ota <version> <md5> <url>"
+                ),
+            }
+        }
+    });
+
     // ===== Startup terminal output =====
-    println!("RPI UDP listener on port {PORT}");
+    println!("RPI UDP listener on port {rpi_port}, swarm port {swarm_port}");
     println!("GPIO: button=BCM{BUTTON_PIN} white=BCM{WHITE_LED_PIN} rgb={:?}", RGB_LED_PINS);
     println!("Protocol: master packets: +++Master,<id>,<reading>***");
+    println!("Protocol: swarm snapshots: +++Swarm,<master>,<id>:<reading>:<age_ms>;...***");
+    println!("Protocol: beacon +++RPI_BEACON*** +++RPI_TIME,<ms>*** every {BEACON_INTERVAL_MS}ms");
+    println!("Console: set <id|*> <name> <value> | get <id|*> | defaults <id|*>  -> +++SET_PARAM/GET_PARAMS/DEFAULT_PARAMS***");
+    println!("Console: ota <version> <md5> <http url>  -> +++OTA_UPDATE*** to one node at a time, master last");
+    println!("Protocol: metrics +++METRICS_REQUESTED*** every {METRICS_SCRAPE_MS}ms, ALERT on reboot, halved loop rate, rx_gap>{METRICS_ALERT_RX_GAP_US}us, heap frag>={METRICS_ALERT_FRAG_PCT}%");
+    println!("Protocol: history +++HISTORY_REQUESTED,<id>,<from_seq>*** every {HISTORY_POLL_MS}ms -> {HISTORY_FILE}");
 
     // ===== UDP receive loop =====
-    let mut buf = [0u8; 1024];
+    // Large enough for a full swarm snapshot (one unfragmented datagram)
+    let mut buf = [0u8; 1500];
+    let beacon = format!("{RPI_START}RPI_BEACON{RPI_END}");
+    let bcast = SocketAddrV4::new(Ipv4Addr::new(255, 255, 255, 255), swarm_port);
+    let mut last_beacon: Option<Instant> = None;
+    let mut history = HistoryPoller::new();
+    let ota_key = std::env::var("SWARM_OTA_KEY").unwrap_or_else(|_| OTA_DEFAULT_KEY.to_string());
+    let mut rollout = OtaRollout::new(ota_key);
+    let mut metrics = MetricsCollector::new();
 
     loop {
         if reset_flag.load(Ordering::SeqCst) {
@@ -308,6 +903,31 @@ fn main() -> Result<()> {
             continue;
         }
 
+        if last_beacon.map_or(true, |t| t.elapsed() >= Duration::from_millis(BEACON_INTERVAL_MS)) {
+            let _ = sock.send_to(beacon.as_bytes(), bcast);
+            // Swarm time reference; same clock as our log timestamps
+            let now_ms = state.lock().unwrap().ts_ms() as u32;
+            let time = format!("{RPI_START}RPI_TIME,{now_ms}{RPI_END}");
+            let _ = sock.send_to(time.as_bytes(), bcast);
+            last_beacon = Some(Instant::now());
+        }
+
+        if let Some(req) = history.next_request() {
+            let _ = sock.send_to(req.as_bytes(), bcast);
+        }
+        if let Some(req) = metrics.next_request() {
+            let _ = sock.send_to(req.as_bytes(), bcast);
+        }
+
+        if let Ok(job) = ota_rx.try_recv() {
+            println!("OTA rollout {} to {} nodes: {}", job.version, history.order.len(), job.url);
+            rollout.start(job, &history.order);
+        }
+        let master = state.lock().unwrap().last_master_id.clone();
+        if let Some(req) = rollout.next_request(master.as_deref()) {
+            let _ = sock.send_to(req.as_bytes(), bcast);
+        }
+
         match sock.recv_from(&mut buf) {
             Ok((n, _addr)) => {
                 let payload = match std::str::from_utf8(&buf[..n]) {
@@ -315,9 +935,61 @@ fn main() -> Result<()> {
                     Err(_) => continue,
                 };
 
+                if let Some(chunk) = parse_history(payload) {
+                    let _ = append_history(&chunk);
+                    history.resume_at(&chunk.swarm_id, chunk.first_seq + chunk.values.len() as u64);
+                    continue;
+                }
+                if let Some((swarm_id, next)) = parse_history_end(payload) {
+                    history.resume_at(&swarm_id, next);
+                    continue;
+                }
+                if let Some((swarm_id, status, version)) = parse_ota_ack(payload) {
+                    let ts_ms = state.lock().unwrap().ts_ms();
+                    println!("[{ts_ms}] OTA_ACK id={swarm_id} status={status} running={version}");
+                    rollout.on_ack(&swarm_id, &status);
+                    continue;
+                }
+                if let Some((swarm_id, version, downtime_ms, clock)) = parse_ota_done(payload) {
+                    let ts_ms = state.lock().unwrap().ts_ms();
+                    println!("[{ts_ms}] OTA_DONE id={swarm_id} version={version} downtime={downtime_ms}ms clock={clock}");
+                    rollout.on_done(&swarm_id);
+                    continue;
+                }
+                if let Some((swarm_id, m)) = parse_metrics(payload) {
+                    history.note_node(&swarm_id);
+                    let ts_ms = state.lock().unwrap().ts_ms();
+                    metrics.on_metrics(ts_ms, &swarm_id, m);
+                    continue;
+                }
+                if let Some(reply) = parse_param_reply(payload) {
+                    let ts_ms = state.lock().unwrap().ts_ms();
+                    println!("[{ts_ms}] {reply}");
+                    continue;
+                }
+
+                if let Some((master_id, entries)) = parse_snapshot(payload) {
+                    history.note_node(&master_id);
+                    for e in &entries {
+                        history.note_node(&e.swarm_id);
+                    }
+                    let ts_ms = state.lock().unwrap().ts_ms();
+                    let nodes: Vec<String> = entries
+                        .iter()
+                        .map(|e| format!("{}:{}@{}ms", e.swarm_id, e.reading, e.age_ms))
+                        .collect();
+                    println!(
+                        "[{ts_ms}] SNAPSHOT master={master_id} nodes={} {}",
+                        entries.len(),
+                        nodes.join(" ")
+                    );
+                    continue;
+                }
+
                 let Some((swarm_id, reading)) = parse_message(payload) else {
                     continue;
                 };
+                history.note_node(&swarm_id);
 
                 // Log to file (keep behavior)
                 let _ = append_log(&swarm_id, reading);